@@ -0,0 +1,69 @@
+#include "bench.h"
+#include <stdio.h>
+#include <time.h>
+
+// A run of the benchmark takes at least this long
+#define BENCH_MIN_NS 100000000.0
+
+// The fastest of this many runs is reported
+#define BENCH_RUNS 5
+
+static unsigned char frame[BENCH_WIDTH * BENCH_HEIGHT / 8];
+static unsigned char frame_red[BENCH_WIDTH * BENCH_HEIGHT / 8];
+static int use_red_plane;
+static Paint paint;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double time_iterations(bench_fn fn, const void* arg, long iterations)
+{
+    double start = now_ns();
+
+    for (long i = 0; i < iterations; i++) {
+        fn(&paint, arg);
+    }
+
+    return now_ns() - start;
+}
+
+Paint* bench_paint(void)
+{
+    paint_init_planes(&paint, frame, use_red_plane ? frame_red : NULL, BENCH_WIDTH, BENCH_HEIGHT);
+    clear(&paint, INK_WHITE);
+
+    return &paint;
+}
+
+void bench_use_red_plane(int red_plane)
+{
+    use_red_plane = red_plane;
+}
+
+void bench_run(const char* name, bench_fn fn, const void* arg, double pixels)
+{
+    long iterations = 1;
+    double best;
+
+    bench_paint();
+    while (time_iterations(fn, arg, iterations) < BENCH_MIN_NS) {
+        iterations *= 2;
+    }
+
+    best = time_iterations(fn, arg, iterations);
+    for (int run = 1; run < BENCH_RUNS; run++) {
+        double elapsed = time_iterations(fn, arg, iterations);
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    printf("{\"bench\": \"%s\", \"iterations\": %ld, \"ns_per_op\": %.1f, \"pixels_per_s\": %.0f}\n",
+        name, iterations, best / iterations, pixels * iterations / best * 1e9);
+    fflush(stdout);
+}
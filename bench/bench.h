@@ -0,0 +1,39 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "epdpaint.h"
+
+// Size of the display the benchmarks draw on
+#define BENCH_WIDTH 400
+#define BENCH_HEIGHT 300
+
+// Benchmarks built with BENCH_RLE draw the compressed fonts and icons,
+// BENCH_PACKED the packed fonts and the compressed icons, BENCH_ASSETS the
+// fonts and icons of the asset image at that path
+#ifdef BENCH_ASSETS
+#define BENCH_NAME(name) name "_assets"
+#elif defined(BENCH_PACKED)
+#define BENCH_NAME(name) name "_packed"
+#elif defined(BENCH_RLE)
+#define BENCH_NAME(name) name "_rle"
+#else
+#define BENCH_NAME(name) name
+#endif
+
+typedef void (*bench_fn)(Paint* paint, const void* arg);
+
+/* Canvas over a frame buffer of the size of the display, cleared */
+Paint* bench_paint(void);
+
+/* The benchmarks run after this draw on a canvas with a red plane as well, or without */
+void bench_use_red_plane(int red_plane);
+
+/**
+ *  @brief: time fn, repeated until a run takes long enough to measure, and
+ *          print one JSON line with the fastest of a few runs:
+ *          {"bench": name, "iterations": n, "ns_per_op": t, "pixels_per_s": p}
+ *  @param pixels: the number of pixels one call of fn draws
+ */
+void bench_run(const char* name, bench_fn fn, const void* arg, double pixels);
+
+#endif
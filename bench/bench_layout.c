@@ -0,0 +1,248 @@
+#include "bench.h"
+#ifdef BENCH_ASSETS
+#include "assets.h"
+#elif defined(BENCH_PACKED)
+#include "icons_rle.h"
+#include "ubuntu10_packed.h"
+#include "ubuntu12_packed.h"
+#include "ubuntu24_packed.h"
+#elif defined(BENCH_RLE)
+#include "icons_rle.h"
+#include "ubuntu10_rle.h"
+#include "ubuntu12_rle.h"
+#include "ubuntu24_rle.h"
+#else
+#include "icons.h"
+#include "ubuntu10.h"
+#include "ubuntu12.h"
+#include "ubuntu24.h"
+#endif
+#include <stdio.h>
+
+/* The frame weather_to_display_task() draws, with fixed weather data */
+
+typedef struct {
+    const char* day;
+    const char* date;
+    int temperature_min;
+    int temperature_max;
+    const char* icon;
+} BenchForecast;
+
+static const BenchForecast forecasts[8] = {
+    { "Today", "17 - 10", 8, 14, "rain" },
+    { "Tomorrow", "18 - 10", 7, 13, "daycloudy" },
+    { "Sunday", "19 - 10", 6, 12, "cloudy" },
+    { "Monday", "20 - 10", 9, 15, "daysunny" },
+    { "Tuesday", "21 - 10", 10, 16, "sleet" },
+    { "Wednesday", "22 - 10", 4, 11, "snow" },
+    { "Thursday", "23 - 10", 5, 12, "fog" },
+    { "Friday", "24 - 10", 8, 13, "strongwind" },
+};
+
+// The fonts and icons of the layout, compiled in or from the asset image
+typedef struct {
+    const tFont* ubuntu10;
+    const tFont* ubuntu12;
+    const tFont* ubuntu24;
+    const tImage* current;
+    const tImage* forecasts[8];
+    // Strings kept from the wakes before, and the number of this wake
+    TextCache* text_cache;
+    int wake;
+} LayoutAssets;
+
+#ifndef BENCH_ASSETS
+/* Only the icons the layout draws */
+static const tImage* find_icon(const char* name)
+{
+    static const struct {
+        const char* name;
+        const tImage* image;
+    } icons[] = {
+        { "wirain", &wirain },
+        { "rain", &rain },
+        { "daycloudy", &daycloudy },
+        { "cloudy", &cloudy },
+        { "daysunny", &daysunny },
+        { "sleet", &sleet },
+        { "snow", &snow },
+        { "fog", &fog },
+        { "strongwind", &strongwind },
+    };
+
+    for (size_t i = 0; i < sizeof(icons) / sizeof(icons[0]); i++) {
+        if (strcmp(icons[i].name, name) == 0) {
+            return icons[i].image;
+        }
+    }
+    return NULL;
+}
+#endif
+
+static int load_assets(LayoutAssets* assets)
+{
+#ifdef BENCH_ASSETS
+    if (assets_open(BENCH_ASSETS) != 0) {
+        return -1;
+    }
+    assets->ubuntu10 = asset_font("Ubuntu10");
+    assets->ubuntu12 = asset_font("Ubuntu12");
+    assets->ubuntu24 = asset_font("Ubuntu24");
+    assets->current = asset_image("wirain");
+    for (size_t i = 0; i < sizeof(forecasts) / sizeof(forecasts[0]); i++) {
+        assets->forecasts[i] = asset_image(forecasts[i].icon);
+    }
+#else
+    assets->ubuntu10 = &Ubuntu10;
+    assets->ubuntu12 = &Ubuntu12;
+    assets->ubuntu24 = &Ubuntu24;
+    assets->current = find_icon("wirain");
+    for (size_t i = 0; i < sizeof(forecasts) / sizeof(forecasts[0]); i++) {
+        assets->forecasts[i] = find_icon(forecasts[i].icon);
+    }
+#endif
+    if (assets->ubuntu10 == NULL || assets->ubuntu12 == NULL || assets->ubuntu24 == NULL || assets->current == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(forecasts) / sizeof(forecasts[0]); i++) {
+        if (assets->forecasts[i] == NULL) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_weather_layout(Paint* paint, const void* arg)
+{
+    const LayoutAssets* assets = arg;
+    char tmp_buff[30];
+
+    clear(paint, INK_WHITE);
+    paint_clear_dirty(paint);
+
+    draw_bitmap_mono_in_center(paint, 2, 0, 500, 40, assets->current, INK_BLACK);
+
+    sprintf(tmp_buff, "%0.1f º", 12.5 + assets->wake);
+    draw_string_in_grid_align_center(paint, 3, 0, 400, 45, tmp_buff, assets->ubuntu24, INK_BLACK);
+
+    TextLayout summary_layout;
+    int summary_lines = layout_paragraph(&summary_layout, "Light rain until evening.", assets->ubuntu12, 400 / 2, 2);
+    int row_offset = summary_lines > 1 ? font_line_height(assets->ubuntu12) : 0;
+    draw_paragraph(paint, &summary_layout, 400 / 2, 65, 400 / 2, TEXT_ALIGN_CENTER, INK_BLACK);
+
+    sprintf(tmp_buff, "Humidity: %d%%", 87 + assets->wake);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, row_offset + 85, tmp_buff, assets->ubuntu12, INK_BLACK);
+
+    sprintf(tmp_buff, "Pressure:%d hPa", 1013);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, row_offset + 105, tmp_buff, assets->ubuntu12, INK_BLACK);
+
+    sprintf(tmp_buff, "Wind :%d km/h (%s)", 12, "SW");
+    draw_string_in_grid_align_center(paint, 2, 1, 400, row_offset + 125, tmp_buff, assets->ubuntu12, INK_BLACK);
+
+    sprintf(tmp_buff, "Chance of Precipitation : %d%%", 80);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, row_offset + 145, tmp_buff, assets->ubuntu12, INK_BLACK);
+
+    for (size_t i = 0; i < (sizeof(forecasts) / sizeof(forecasts[0])); i++) {
+        draw_string_in_grid_align_center(paint, 7, i, 400, 210, forecasts[i].day, assets->ubuntu10, INK_BLACK);
+
+        draw_string_in_grid_align_center(paint, 7, i, 400, 225, forecasts[i].date, assets->ubuntu10, INK_BLACK);
+
+        sprintf(tmp_buff, "%d - %d º", forecasts[i].temperature_min, forecasts[i].temperature_max);
+        draw_string_in_grid_align_center(paint, 7, i, 400, 240, tmp_buff, assets->ubuntu10, INK_BLACK);
+
+        draw_bitmap_mono_in_center(paint, 7, i, 400, 255, assets->forecasts[i], INK_BLACK);
+    }
+
+    draw_string_in_grid_align_left(paint, 1, 0, 2, 400, 0, "Garderen", assets->ubuntu12, INK_BLACK);
+
+    sprintf(tmp_buff, "Last updated: 17 Oct 12:%02d", (40 + assets->wake) % 60);
+    draw_string_in_grid_align_right(paint, 1, 0, 2, 400, 0, tmp_buff, assets->ubuntu12, INK_BLACK);
+
+    draw_horizontal_line(paint, 0, 14, 400, INK_BLACK);
+    draw_horizontal_line(paint, 0, 200, 400, INK_BLACK);
+    draw_horizontal_line(paint, 0, 0, 400, INK_BLACK);
+    draw_vertical_line(paint, 0, 0, 300, INK_BLACK);
+    draw_horizontal_line(paint, 0, 299, 400, INK_BLACK);
+    draw_vertical_line(paint, 399, 0, 300, INK_BLACK);
+
+    for (size_t i = 1; i < 7; i++) {
+        draw_vertical_line(paint, (400 / 7 * i), 200, 138, INK_BLACK);
+    }
+}
+
+/*
+ * Every call is a wake after deep sleep: the strings drawn in the wakes
+ * before are in the text cache, the temperature, the humidity and the time
+ * of the update change.
+ */
+static void bench_weather_layout_text_cache(Paint* paint, const void* arg)
+{
+    LayoutAssets assets = *(const LayoutAssets*)arg;
+    static int wake;
+
+    assets.wake = wake++;
+    text_cache_begin(assets.text_cache);
+    paint_set_text_cache(paint, assets.text_cache);
+    bench_weather_layout(paint, &assets);
+    paint_set_text_cache(paint, NULL);
+}
+
+// Rows of a band, as display_banded_frame() draws them
+#define BENCH_BAND_ROWS 20
+
+/*
+ * The layout replayed for every band of the display into two small
+ * buffers, like display_banded_frame() draws it
+ */
+static void bench_weather_layout_banded(Paint* paint, const void* arg)
+{
+    static unsigned char bands[2][2][BENCH_WIDTH / 8 * BENCH_BAND_ROWS];
+
+    for (int top = 0, band = 0; top < BENCH_HEIGHT; top += BENCH_BAND_ROWS, band++) {
+        paint_set_band(paint, bands[band & 1][0], paint->image_red != NULL ? bands[band & 1][1] : NULL, top, BENCH_BAND_ROWS);
+        bench_weather_layout(paint, arg);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    static TextCache text_cache;
+    LayoutAssets assets = { 0 };
+
+    if (load_assets(&assets) != 0) {
+        fprintf(stderr, "fonts or icons missing\n");
+        return 1;
+    }
+    bench_run(BENCH_NAME("weather_layout"), bench_weather_layout, &assets, BENCH_WIDTH * BENCH_HEIGHT);
+
+    assets.text_cache = &text_cache;
+    bench_run(BENCH_NAME("weather_layout_text_cache"), bench_weather_layout_text_cache, &assets, BENCH_WIDTH * BENCH_HEIGHT);
+    assets.text_cache = NULL;
+
+    bench_use_red_plane(1);
+    bench_run(BENCH_NAME("weather_layout_planes"), bench_weather_layout, &assets, BENCH_WIDTH * BENCH_HEIGHT);
+    bench_run(BENCH_NAME("weather_layout_banded_planes"), bench_weather_layout_banded, &assets, BENCH_WIDTH * BENCH_HEIGHT);
+    bench_use_red_plane(0);
+    bench_run(BENCH_NAME("weather_layout_banded"), bench_weather_layout_banded, &assets, BENCH_WIDTH * BENCH_HEIGHT);
+
+    // The frame can be written out to compare the output of two versions
+    if (argc > 1) {
+        Paint* paint = bench_paint();
+        FILE* f = fopen(argv[1], "wb");
+
+        if (f == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+        bench_weather_layout(paint, &assets);
+        // PBM has bit 1 for black, the frame buffer for white
+        fprintf(f, "P4\n%d %d\n", BENCH_WIDTH, BENCH_HEIGHT);
+        for (int i = 0; i < BENCH_WIDTH * BENCH_HEIGHT / 8; i++) {
+            fputc(~paint->image[i] & 0xff, f);
+        }
+        fclose(f);
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "bench.h"
+#ifdef BENCH_RLE
+#include "icons_rle.h"
+#else
+#include "icons.h"
+#endif
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} Shape;
+
+typedef struct {
+    int x;
+    int y;
+    const tImage* image;
+} Blit;
+
+static void bench_clear(Paint* paint, const void* arg)
+{
+    (void)arg;
+    clear(paint, INK_WHITE);
+}
+
+static void bench_horizontal_line(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_horizontal_line(paint, s->x, s->y, s->width, INK_BLACK);
+}
+
+static void bench_vertical_line(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_vertical_line(paint, s->x, s->y, s->height, INK_BLACK);
+}
+
+static void bench_line(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_line(paint, s->x, s->y, s->x + s->width - 1, s->y + s->height - 1, INK_BLACK);
+}
+
+static void bench_rectangle(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_rectangle(paint, s->x, s->y, s->x + s->width - 1, s->y + s->height - 1, INK_BLACK);
+}
+
+static void bench_filled_rectangle(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_filled_rectangle(paint, s->x, s->y, s->x + s->width - 1, s->y + s->height - 1, INK_BLACK);
+}
+
+static void bench_filled_rectangle_red(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_filled_rectangle(paint, s->x, s->y, s->x + s->width - 1, s->y + s->height - 1, INK_RED);
+}
+
+static void bench_circle(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_circle(paint, s->x, s->y, s->width / 2, INK_BLACK);
+}
+
+static void bench_filled_circle(Paint* paint, const void* arg)
+{
+    const Shape* s = arg;
+    draw_filled_circle(paint, s->x, s->y, s->width / 2, INK_BLACK);
+}
+
+static void bench_bitmap(Paint* paint, const void* arg)
+{
+    const Blit* b = arg;
+    draw_bitmap_mono(paint, b->x, b->y, b->image, INK_BLACK);
+}
+
+static void bench_bitmap_red(Paint* paint, const void* arg)
+{
+    const Blit* b = arg;
+    draw_bitmap_mono(paint, b->x, b->y, b->image, INK_RED);
+}
+
+int main(void)
+{
+    static const Shape row = { 0, 150, BENCH_WIDTH, 1 };
+    static const Shape column = { 200, 0, 1, BENCH_HEIGHT };
+    static const Shape diagonal = { 0, 0, BENCH_WIDTH, BENCH_HEIGHT };
+    static const Shape aligned = { 96, 100, 200, 100 };
+    static const Shape unaligned = { 99, 100, 200, 100 };
+    static const Shape circle = { 200, 150, 200, 200 };
+    static const Blit icon_aligned = { 120, 40, &wirain };
+    static const Blit icon_unaligned = { 123, 40, &wirain };
+    static const Blit small_icon = { 181, 255, &rain };
+
+    bench_run(BENCH_NAME("clear"), bench_clear, NULL, BENCH_WIDTH * BENCH_HEIGHT);
+    bench_run(BENCH_NAME("horizontal_line_400"), bench_horizontal_line, &row, row.width);
+    bench_run(BENCH_NAME("vertical_line_300"), bench_vertical_line, &column, column.height);
+    bench_run(BENCH_NAME("line_400x300"), bench_line, &diagonal, diagonal.width);
+    bench_run(BENCH_NAME("rectangle_200x100"), bench_rectangle, &aligned, 2 * (aligned.width + aligned.height));
+    bench_run(BENCH_NAME("filled_rectangle_200x100"), bench_filled_rectangle, &aligned, aligned.width * aligned.height);
+    bench_run(BENCH_NAME("filled_rectangle_200x100_unaligned"), bench_filled_rectangle, &unaligned, unaligned.width * unaligned.height);
+    // a midpoint circle of radius r draws about 2 * pi * r pixels
+    bench_run(BENCH_NAME("circle_r100"), bench_circle, &circle, 3.14159 * circle.width);
+    bench_run(BENCH_NAME("filled_circle_r100"), bench_filled_circle, &circle, 3.14159 * circle.width * circle.width / 4);
+    bench_run(BENCH_NAME("bitmap_160x160"), bench_bitmap, &icon_aligned, 160 * 160);
+    bench_run(BENCH_NAME("bitmap_160x160_unaligned"), bench_bitmap, &icon_unaligned, 160 * 160);
+    bench_run(BENCH_NAME("bitmap_40x40_unaligned"), bench_bitmap, &small_icon, 40 * 40);
+
+    // Tri-color canvas, both planes are written in the same pass
+    bench_use_red_plane(1);
+    bench_run(BENCH_NAME("clear_planes"), bench_clear, NULL, BENCH_WIDTH * BENCH_HEIGHT);
+    bench_run(BENCH_NAME("filled_rectangle_200x100_planes"), bench_filled_rectangle, &unaligned, unaligned.width * unaligned.height);
+    bench_run(BENCH_NAME("filled_rectangle_200x100_red"), bench_filled_rectangle_red, &unaligned, unaligned.width * unaligned.height);
+    bench_run(BENCH_NAME("bitmap_160x160_planes"), bench_bitmap, &icon_unaligned, 160 * 160);
+    bench_run(BENCH_NAME("bitmap_160x160_red"), bench_bitmap_red, &icon_unaligned, 160 * 160);
+    bench_use_red_plane(0);
+
+    return 0;
+}
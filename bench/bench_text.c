@@ -0,0 +1,105 @@
+#include "bench.h"
+#ifdef BENCH_PACKED
+#include "ubuntu10_packed.h"
+#include "ubuntu12_packed.h"
+#include "ubuntu14_packed.h"
+#include "ubuntu16_packed.h"
+#include "ubuntu18_packed.h"
+#include "ubuntu20_packed.h"
+#include "ubuntu22_packed.h"
+#include "ubuntu24_packed.h"
+#include "ubuntu8_packed.h"
+#elif defined(BENCH_RLE)
+#include "ubuntu10_rle.h"
+#include "ubuntu12_rle.h"
+#include "ubuntu14_rle.h"
+#include "ubuntu16_rle.h"
+#include "ubuntu18_rle.h"
+#include "ubuntu20_rle.h"
+#include "ubuntu22_rle.h"
+#include "ubuntu24_rle.h"
+#include "ubuntu8_rle.h"
+#else
+#include "ubuntu10.h"
+#include "ubuntu12.h"
+#include "ubuntu14.h"
+#include "ubuntu16.h"
+#include "ubuntu18.h"
+#include "ubuntu20.h"
+#include "ubuntu22.h"
+#include "ubuntu24.h"
+#include "ubuntu8.h"
+#endif
+#include <stdio.h>
+
+// Representative of the strings on the display, with a character outside ASCII
+#define BENCH_STRING "Chance of Precipitation : 80% 12.5 º"
+
+// A summary too long for the half of the display it is drawn in
+#define BENCH_PARAGRAPH "Mostly cloudy throughout the day and breezy starting in the afternoon, continuing until evening."
+
+typedef struct {
+    const char* name;
+    const tFont* font;
+} FontBench;
+
+static void bench_draw_string(Paint* paint, const void* arg)
+{
+    const FontBench* f = arg;
+    draw_string(paint, BENCH_STRING, 3, 100, f->font, INK_BLACK);
+}
+
+static void bench_draw_string_centered(Paint* paint, const void* arg)
+{
+    const FontBench* f = arg;
+    draw_string_in_grid_align_center(paint, 2, 1, BENCH_WIDTH, 100, BENCH_STRING, f->font, INK_BLACK);
+}
+
+static void bench_draw_paragraph(Paint* paint, const void* arg)
+{
+    const FontBench* f = arg;
+    TextLayout layout;
+
+    layout_paragraph(&layout, BENCH_PARAGRAPH, f->font, BENCH_WIDTH / 2, 2);
+    draw_paragraph(paint, &layout, BENCH_WIDTH / 2, 100, BENCH_WIDTH / 2, TEXT_ALIGN_CENTER, INK_BLACK);
+}
+
+static void bench_calculate_width(Paint* paint, const void* arg)
+{
+    const FontBench* f = arg;
+    (void)paint;
+    calculate_width(BENCH_STRING, f->font);
+}
+
+int main(void)
+{
+    static const FontBench fonts[] = {
+        { "ubuntu8", &Ubuntu8 },
+        { "ubuntu10", &Ubuntu10 },
+        { "ubuntu12", &Ubuntu12 },
+        { "ubuntu14", &Ubuntu14 },
+        { "ubuntu16", &Ubuntu16 },
+        { "ubuntu18", &Ubuntu18 },
+        { "ubuntu20", &Ubuntu20 },
+        { "ubuntu22", &Ubuntu22 },
+        { "ubuntu24", &Ubuntu24 },
+    };
+    char name[64];
+
+    for (size_t i = 0; i < sizeof(fonts) / sizeof(fonts[0]); i++) {
+        const FontBench* f = &fonts[i];
+        int height = font_line_height(f->font);
+        double pixels = (double)calculate_width(BENCH_STRING, f->font) * height;
+
+        snprintf(name, sizeof(name), BENCH_NAME("draw_string_%s"), f->name);
+        bench_run(name, bench_draw_string, f, pixels);
+        snprintf(name, sizeof(name), BENCH_NAME("draw_string_centered_%s"), f->name);
+        bench_run(name, bench_draw_string_centered, f, pixels);
+        snprintf(name, sizeof(name), BENCH_NAME("draw_paragraph_%s"), f->name);
+        bench_run(name, bench_draw_paragraph, f, (double)BENCH_WIDTH / 2 * 2 * height);
+        snprintf(name, sizeof(name), BENCH_NAME("calculate_width_%s"), f->name);
+        bench_run(name, bench_calculate_width, f, pixels);
+    }
+
+    return 0;
+}
@@ -15,4 +15,14 @@ COMPONENT_ADD_INCLUDEDIRS := include
 
 # embed files from the "certs" directory as binary data symbols
 # in the app
-COMPONENT_EMBED_TXTFILES := server_root_cert.pem
\ No newline at end of file
+COMPONENT_EMBED_TXTFILES := server_root_cert.pem
+
+# weather_icons.h is generated in the build directory, see tools/icon_registry.py.
+# darksky.h includes it, so main generates its own copy from the same files.
+COMPONENT_EXTRA_INCLUDES := $(COMPONENT_BUILD_DIR)
+COMPONENT_EXTRA_CLEAN := weather_icons.h
+
+src/darksky.o: weather_icons.h
+
+weather_icons.h: $(PROJECT_PATH)/main/weather_icons.txt $(COMPONENT_PATH)/darksky_icons.txt $(PROJECT_PATH)/tools/icon_registry.py
+	$(PYTHON) $(PROJECT_PATH)/tools/icon_registry.py -o $@ $(PROJECT_PATH)/main/weather_icons.txt darksky=$(COMPONENT_PATH)/darksky_icons.txt
@@ -23,6 +23,9 @@
 
 #include "cJSON.h"
 
+/* Generated from main/weather_icons.txt and darksky_icons.txt, see tools/icon_registry.py */
+#include "weather_icons.h"
+
 #define WEB_SERVER "api.darksky.net"
 #define WEB_PORT "443"
 #define WEB_URL "https://api.darksky.net/forecast/" CONFIG_DARKSKY_API_KEY "/" CONFIG_LATITUDE "," CONFIG_LONGITUDE "?lang=en&exclude=hourly,flag,minutely&units=auto"
@@ -45,16 +48,16 @@ extern const uint8_t server_root_cert_pem_end[] asm("_binary_server_root_cert_pe
 
 typedef struct Forecasts {
     time_t time;
-    char summary[50];
-    char icon[20];
+    char summary[128];
+    WeatherIcon icon;
     double temperatureMax;
     double temperatureMin;
     double humidity;
     int pressure;
 } Forecast;
 
-char summary[50];
-char icon[20];
+char summary[128];
+WeatherIcon icon;
 double temperature;
 double humidity;
 int pressure;
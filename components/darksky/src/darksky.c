@@ -107,12 +107,12 @@ void get_current_weather_task(void* pvParameters)
 
     cJSON* json_currently_summary = cJSON_GetObjectItemCaseSensitive(json_currently, "summary");
     if (cJSON_IsString(json_currently_summary) && (json_currently_summary->valuestring != NULL)) {
-        sprintf(summary, "%s", json_currently_summary->valuestring);
+        snprintf(summary, sizeof(summary), "%s", json_currently_summary->valuestring);
     }
 
     cJSON* json_currently_icon = cJSON_GetObjectItemCaseSensitive(json_currently, "icon");
     if (cJSON_IsString(json_currently_icon) && (json_currently_icon->valuestring != NULL)) {
-        sprintf(icon, "%s", json_currently_icon->valuestring);
+        icon = darksky_icon(json_currently_icon->valuestring);
     }
 
     cJSON* json_currently_temperature = cJSON_GetObjectItemCaseSensitive(json_currently, "temperature");
@@ -161,13 +161,13 @@ void get_current_weather_task(void* pvParameters)
         cJSON* json_daily_data_x_summary = cJSON_GetObjectItemCaseSensitive(json_daily_data_x, "summary");
 
         if (cJSON_IsString(json_daily_data_x_summary) && (json_daily_data_x_summary->valuestring != NULL)) {
-            sprintf(forecasts[q].summary, "%s", json_daily_data_x_summary->valuestring);
+            snprintf(forecasts[q].summary, sizeof(forecasts[q].summary), "%s", json_daily_data_x_summary->valuestring);
         }
 
         cJSON* json_daily_data_x_icon = cJSON_GetObjectItemCaseSensitive(json_daily_data_x, "icon");
 
         if (cJSON_IsString(json_daily_data_x_icon) && (json_daily_data_x_icon->valuestring != NULL)) {
-            sprintf(forecasts[q].icon, "%s", json_daily_data_x_icon->valuestring);
+            forecasts[q].icon = darksky_icon(json_daily_data_x_icon->valuestring);
         }
 
         cJSON* json_daily_data_x_temperature_max = cJSON_GetObjectItemCaseSensitive(json_daily_data_x, "temperatureMax");
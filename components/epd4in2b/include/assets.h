@@ -0,0 +1,77 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "image.h"
+#include <stdint.h>
+
+// Partition the fonts and icons are read from, see partitions.csv
+#define ASSET_PARTITION_LABEL "assets"
+#define ASSET_PARTITION_SUBTYPE 0x40
+
+// Image of the asset partition, built by tools/asset_image.py
+#define ASSET_MAGIC 0x41445045 // "EPDA"
+#define ASSET_VERSION 4
+#define ASSET_NAME_LENGTH 24
+
+// Type of an asset in the index
+#define ASSET_IMAGE 1
+#define ASSET_FONT 2
+
+// All fields are little endian, every record starts at a multiple of 4 bytes
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count; // entries in the index that follows the header
+    uint32_t size; // of the whole image
+} tAssetHeader;
+
+typedef struct {
+    char name[ASSET_NAME_LENGTH]; // zero terminated
+    uint32_t type;
+    uint32_t offset; // of the record, from the start of the image
+    uint32_t size;
+} tAssetEntry;
+
+// Record of an ASSET_IMAGE, followed by its data. width x height is the
+// box of the ink at left, top of the full_width x full_height icon.
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t dataSize;
+    uint8_t compression;
+    uint16_t reserved;
+    uint16_t left;
+    uint16_t top;
+    uint16_t full_width;
+    uint16_t full_height;
+} tAssetImage;
+
+// Record of an ASSET_FONT, followed by range_count tFontRange, length tGlyph,
+// kerning_count tKernPair and the atlas
+typedef struct {
+    uint16_t length;
+    uint8_t height;
+    uint8_t baseline;
+    uint16_t range_count;
+    uint16_t kerning_count;
+    uint32_t hash;
+} tAssetFont;
+
+/**
+ *  @brief: map the asset image and check its header and index. on the
+ *          ESP32 source is the label of the partition, on a host the
+ *          path of the image file.
+ *  @return: 0 on success, -1 when the image is missing or not valid
+ */
+int assets_open(const char* source);
+void assets_close(void);
+
+/**
+ *  @brief: the assets by the name they have in the index, NULL when there
+ *          is no such asset. they point into the mapped image and are
+ *          valid until assets_close().
+ */
+const tImage* asset_image(const char* name);
+const tFont* asset_font(const char* name);
+
+#endif /* ASSETS_H */
@@ -2,11 +2,19 @@
 #define EPD4IN2_H
 
 #include "epdif.h"
+#include "epdpaint.h"
+#include "freertos/event_groups.h"
+#include <stdint.h>
 
 // Display resolution
 #define EPD_WIDTH 400
 #define EPD_HEIGHT 300
 
+// Rows per band compared by display_changed_frame(), and drawn at a time by
+// display_banded_frame()
+#define EPD_FRAME_BAND_ROWS 20
+#define EPD_FRAME_BANDS ((EPD_HEIGHT + EPD_FRAME_BAND_ROWS - 1) / EPD_FRAME_BAND_ROWS)
+
 // EPD4IN2 commands
 #define PANEL_SETTING 0x00
 #define POWER_SETTING 0x01
@@ -47,18 +55,40 @@
 #define READ_OTP 0xA2
 #define POWER_SAVING 0xE3
 
+// Hashes of the bands of the frame on the display, small enough to keep in RTC memory
+typedef struct {
+    uint32_t bands[EPD_FRAME_BANDS];
+    int valid;
+} FrameHistory;
+
+// Bits of epd_events(): no frame is being sent or refreshed, and the last
+// one failed because the display hung
+#define EPD_IDLE_BIT BIT0
+#define EPD_FAULT_BIT BIT1
+
+// Draws a whole frame on a canvas that keeps only one band of it, see
+// display_banded_frame()
+typedef void (*EpdDrawFrame)(Paint* paint, void* arg);
+
 int epd4in2b_init(void);
 void send_command(unsigned char command);
 void send_data(unsigned char data);
-void wait_untile_idle(void);
+int wait_untile_idle(void);
 void reset(void);
 void set_partial_window(const unsigned char* buffer_black, const unsigned char* buffer_red, int x, int y, int w, int l);
 void set_partial_window_black(const unsigned char* buffer_black, int x, int y, int w, int l);
 void set_partial_window_red(const unsigned char* buffer_red, int x, int y, int w, int l);
-void display_frame(const unsigned char* frame_black, const unsigned char* frame_red);
-void refresh_display(void);
+int display_frame(const unsigned char* frame_black, const unsigned char* frame_red);
+int display_dirty_frame(Paint* paint);
+int display_changed_frame(Paint* paint, FrameHistory* history);
+int display_banded_frame(EpdDrawFrame draw, void* arg, int with_red, FrameHistory* history);
+int refresh_display(void);
 void clear_frame(void);
 void epd4in2_sleep(void);
+int display_changed_frame_async(Paint* paint, FrameHistory* history, int sleep_after);
+int display_banded_frame_async(EpdDrawFrame draw, void* arg, int with_red, FrameHistory* history, int sleep_after);
+EventGroupHandle_t epd_events(void);
+int epd_wait_idle(unsigned int timeout_ms);
 
 #endif /* EPD4IN2_H */
 
@@ -46,12 +46,35 @@
 #define RST_PIN GPIO_NUM_32
 #define BUSY_PIN GPIO_NUM_35
 
+// SPI clock of the display (see menuconfig)
+#ifdef CONFIG_EPD_SPI_CLOCK_MHZ
+#define SPI_CLOCK_HZ (CONFIG_EPD_SPI_CLOCK_MHZ * 1000 * 1000)
+#else
+#define SPI_CLOCK_HZ (2 * 1000 * 1000)
+#endif
+
+// Longest the display may stay busy before that is a fault (see menuconfig)
+#ifdef CONFIG_EPD_BUSY_TIMEOUT_MS
+#define BUSY_TIMEOUT_MS CONFIG_EPD_BUSY_TIMEOUT_MS
+#else
+#define BUSY_TIMEOUT_MS 30000
+#endif
+
+// Bytes of one DMA transaction, and transactions that can be queued at once
+#define SPI_CHUNK_SIZE 4096
+#define SPI_QUEUE_SIZE 6
+
 spi_device_handle_t spi;
 
 int ifinit(void);
 void digital_write(gpio_num_t pin, int value);
 int digital_read(gpio_num_t pin);
 void delay_ms(unsigned int delaytime);
+int wait_busy_released(unsigned int timeout_ms);
 void spi_transfer(unsigned char data);
+void spi_write(const unsigned char* data, int length);
+void spi_write_rows(const unsigned char* data, int stride, int row_length, int rows);
+void spi_fill(unsigned char value, int length);
+void spi_wait(void);
 
 #endif
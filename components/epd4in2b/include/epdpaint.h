@@ -1,7 +1,6 @@
 #ifndef EPDPAINT_H
 #define EPDPAINT_H
 
-#include "esp_log.h"
 #include "image.h"
 #include <stdio.h>
 #include <string.h>
@@ -12,28 +11,157 @@
 #define ROTATE_180 2
 #define ROTATE_270 3
 
+// Canvas orientation, fixed at compile time (see menuconfig)
+#ifdef CONFIG_EPD_PAINT_ROTATE
+#define PAINT_ROTATE CONFIG_EPD_PAINT_ROTATE
+#else
+#define PAINT_ROTATE ROTATE_0
+#endif
+
 // Color inverse. 1 or 0 = set or reset a bit if set a colored pixel
 #define IF_INVERT_COLOR 0
 
-void paint(unsigned char* image, int width, int height);
-void clear(int colored);
-void draw_absolute_pixel(int x, int y, int colored);
-void draw_pixel(int x, int y, int colored);
-void draw_line(int x0, int y0, int x1, int y1, int colored);
-void draw_horizontal_line(int x, int y, int width, int colored);
-void draw_vertical_line(int x, int y, int height, int colored);
-void draw_rectangle(int x0, int y0, int x1, int y1, int colored);
-void draw_filled_rectangle(int x0, int y0, int x1, int y1, int colored);
-void draw_circle(int x, int y, int radius, int colored);
-void draw_filled_circle(int x, int y, int radius, int colored);
-void draw_bitmap_mono(int x, int y, const tImage* image);
-void draw_bitmap_mono_in_center(int x_dev, int x_number, int width, int y, const tImage* image);
+// Inks of the tri-color panel. A canvas without red plane draws red as
+// black, so 0 and 1 are the uncolored and colored of a single plane.
+#define INK_WHITE 0
+#define INK_BLACK 1
+#define INK_RED 2
+
+// Number of dirty rectangles a canvas keeps track of
+#define PAINT_MAX_DIRTY_RECTS 16
+
+// Dirty rectangles are merged when their bounding box adds at most this many pixels
+#define PAINT_DIRTY_MERGE_WASTE 512
+
+// Rectangle by absolute coordinates, x and width are multiples of 8
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} PaintRect;
+
+// Number of glyphs a run holds, longer strings are laid out in more runs
+#define GLYPH_RUN_LENGTH 64
+
+// A string decoded once into the glyphs of a font
+typedef struct {
+    const tFont* font;
+    // Indices into the chars of the font, or the glyphs of its packed font
+    uint16_t glyphs[GLYPH_RUN_LENGTH];
+    int advances[GLYPH_RUN_LENGTH];
+    int count;
+    int width;
+} GlyphRun;
+
+// Glyphs a TextLayout holds and lines it breaks them into, the rest of a
+// longer paragraph is cut off with an ellipsis
+#define TEXT_LAYOUT_GLYPHS 128
+#define TEXT_LAYOUT_LINES 4
+
+// Alignment of the lines of a paragraph
+#define TEXT_ALIGN_LEFT 0
+#define TEXT_ALIGN_CENTER 1
+#define TEXT_ALIGN_RIGHT 2
+
+typedef struct {
+    int first; // index of its first glyph in the layout
+    int count;
+    int width;
+} TextLine;
+
+// A paragraph decoded once into the glyphs of a font and broken into lines
+typedef struct {
+    const tFont* font;
+    uint16_t glyphs[TEXT_LAYOUT_GLYPHS];
+    int advances[TEXT_LAYOUT_GLYPHS];
+    TextLine lines[TEXT_LAYOUT_LINES];
+    int line_count;
+} TextLayout;
+
+// Bytes of bitmaps and number of strings a TextCache holds (see menuconfig)
+#ifdef CONFIG_EPD_TEXT_CACHE_SIZE
+#define TEXT_CACHE_SIZE CONFIG_EPD_TEXT_CACHE_SIZE
+#else
+#define TEXT_CACHE_SIZE 2048
+#endif
+// The weather layout draws 31 strings, a few of them new in every wake
+#define TEXT_CACHE_ENTRIES 48
+
+// A string in a TextCache, with its bitmap once it was drawn in two wakes
+typedef struct {
+    uint32_t key; // hash of the string and of the font
+    uint16_t wake; // the last one the string was drawn in
+    uint16_t offset; // of the bitmap in the data of the cache
+    uint16_t size; // of the bitmap, 0 when there is none yet
+    uint16_t width; // advance of the whole string
+    // bounding box of the ink, from the pen position and the top of the line
+    int16_t left;
+    int16_t top;
+    uint16_t box_width;
+    uint16_t box_height;
+} TextCacheEntry;
+
+// Strings drawn with packed fonts, rendered once and blitted as one bitmap
+// after that. Small enough to keep in RTC memory across deep sleep.
+typedef struct {
+    uint16_t wake;
+    uint16_t count;
+    uint16_t size; // bytes of data in use
+    TextCacheEntry entries[TEXT_CACHE_ENTRIES];
+    uint8_t data[TEXT_CACHE_SIZE];
+} TextCache;
+
+typedef struct {
+    unsigned char* image;
+    // Second plane of the same size for INK_RED, NULL for none
+    unsigned char* image_red;
+    int width;
+    int height;
+    // Rows of the canvas the planes hold, from top. All of them, or one
+    // band of a frame that is drawn band by band.
+    int top;
+    int rows;
+    // Bounding boxes of everything drawn since the last paint_clear_dirty()
+    PaintRect dirty[PAINT_MAX_DIRTY_RECTS];
+    int dirty_count;
+    // Strings are drawn from here when they are in it, NULL for none
+    TextCache* text_cache;
+} Paint;
+
+void paint_init(Paint* paint, unsigned char* image, int width, int height);
+void paint_init_planes(Paint* paint, unsigned char* image_black, unsigned char* image_red, int width, int height);
+void paint_set_band(Paint* paint, unsigned char* image_black, unsigned char* image_red, int top, int rows);
+void paint_mark_dirty(Paint* paint, int x, int y, int width, int height);
+void paint_clear_dirty(Paint* paint);
+void paint_set_text_cache(Paint* paint, TextCache* cache);
+void text_cache_begin(TextCache* cache);
+void clear(Paint* paint, int ink);
+void fill_absolute_rectangle(Paint* paint, int x, int y, int width, int height, int ink);
+void draw_absolute_pixel(Paint* paint, int x, int y, int ink);
+void draw_pixel(Paint* paint, int x, int y, int ink);
+void fill_rectangle(Paint* paint, int x, int y, int width, int height, int ink);
+void draw_line(Paint* paint, int x0, int y0, int x1, int y1, int ink);
+void draw_horizontal_line(Paint* paint, int x, int y, int width, int ink);
+void draw_vertical_line(Paint* paint, int x, int y, int height, int ink);
+void draw_rectangle(Paint* paint, int x0, int y0, int x1, int y1, int ink);
+void draw_filled_rectangle(Paint* paint, int x0, int y0, int x1, int y1, int ink);
+void draw_circle(Paint* paint, int x, int y, int radius, int ink);
+void draw_filled_circle(Paint* paint, int x, int y, int radius, int ink);
+void draw_bitmap_mono(Paint* paint, int x, int y, const tImage* image, int ink);
+void draw_bitmap_mono_in_center(Paint* paint, int x_dev, int x_number, int width, int y, const tImage* image, int ink);
+void draw_packed_glyph(Paint* paint, int x, int y, const tPackedFont* font, const tGlyph* glyph, int ink);
 const tChar* find_char_by_code(int code, const tFont* font);
 int utf8_next_char(const char* str, int start, int* resultCode, int* nextIndex);
-void draw_string(const char* str, int x, int y, const tFont* font);
-void draw_string_in_grid_align_center(int x_dev, int x_number, int width, int y, const char* str, const tFont* font);
-void draw_string_in_grid_align_left(int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font);
-void draw_string_in_grid_align_right(int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font);
+const char* shape_glyph_run(GlyphRun* run, const char* str, const tFont* font);
+void draw_glyph_run(Paint* paint, const GlyphRun* run, int x, int y, int ink);
+void draw_string(Paint* paint, const char* str, int x, int y, const tFont* font, int ink);
+void draw_string_in_grid_align_center(Paint* paint, int x_dev, int x_number, int width, int y, const char* str, const tFont* font, int ink);
+void draw_string_in_grid_align_left(Paint* paint, int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font, int ink);
+void draw_string_in_grid_align_right(Paint* paint, int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font, int ink);
 int calculate_width(const char* str, const tFont* font);
+int font_line_height(const tFont* font);
+int layout_paragraph(TextLayout* layout, const char* str, const tFont* font, int width, int max_lines);
+void draw_paragraph(Paint* paint, const TextLayout* layout, int x, int y, int width, int align, int ink);
 
 #endif
\ No newline at end of file
@@ -3,20 +3,83 @@
 
 #include <stdint.h>
 
+// How the data of a tImage is stored
+#define IMAGE_RAW 0 // rows of dataSize bit blocks, every row starts in a new block
+#define IMAGE_RLE 1 // run lengths as 4 bit codes, see tools/rle_assets.py
+
 typedef struct {
     const uint8_t* data;
     uint16_t width;
     uint16_t height;
     uint8_t dataSize;
+    uint8_t compression;
+    // Images trimmed to their ink only store the width x height box at
+    // left, top of the full image. LCD Image Converter leaves these 0.
+    uint16_t left;
+    uint16_t top;
+    uint16_t full_width;
+    uint16_t full_height;
 } tImage;
 
 typedef struct {
     long int code;
     const tImage* image;
 } tChar;
+// Characters with consecutive codes, stored at consecutive indices of chars
+typedef struct {
+    int32_t first;
+    int32_t count;
+    int32_t index;
+} tFontRange;
+
+// Advances and kerning of a tPackedFont are fixed point, in 1/16 pixels
+#define GLYPH_ADVANCE_SHIFT 4
+
+// Glyph of a tPackedFont, its bitmap only covers the inked pixels. Fixed
+// size fields, so asset images can store the array as it is used.
+typedef struct {
+    int32_t code;
+    uint32_t offset; // first bit of the bitmap in the atlas
+    uint8_t width;
+    uint8_t height;
+    int8_t left; // from the pen position to the left of the bitmap
+    int8_t top; // from the top of the line to the top of the bitmap
+    uint16_t advance; // from the pen position to the next one, fixed point
+    // Index of the first kerning pair with this glyph on the left, its
+    // pairs end where the ones of the next glyph start
+    uint16_t kerning;
+} tGlyph;
+
+// Kerning pair of a tPackedFont, sorted by the left and then the right glyph
+typedef struct {
+    uint16_t right; // index of the glyph on the right
+    int16_t adjust; // added to the advance of the left glyph, fixed point
+} tKernPair;
+
+// Font with the bitmaps of all glyphs in one atlas, see tools/font_compiler.py
+typedef struct {
+    int length;
+    const tGlyph* glyphs;
+    // 1 bit per pixel, set for uncolored pixels, rows are not padded
+    const uint8_t* atlas;
+    uint8_t height;
+    uint8_t baseline; // from the top of the line
+    int range_count;
+    const tFontRange* ranges;
+    // Of the glyphs and the atlas, tells fonts apart in a TextCache
+    uint32_t hash;
+    int kerning_count;
+    const tKernPair* kerning;
+} tPackedFont;
+
 typedef struct {
     int length;
     const tChar* chars;
+    // Direct index into chars, codes outside the ranges are searched for
+    int range_count;
+    const tFontRange* ranges;
+    // Fonts from tools/font_compiler.py only have this, and no chars
+    const tPackedFont* packed;
 } tFont;
 
 #endif /* FONTS_H */
@@ -0,0 +1,347 @@
+#include "assets.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "esp_partition.h"
+#else
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * The image is used where it is mapped, the tImage and tFont of an asset
+ * only point into it. The ESP32 and the hosts it is built on are little
+ * endian, so the fields are read as they are.
+ */
+
+// What asset_image() and asset_font() return for an entry of the index
+typedef union {
+    tImage image;
+    struct {
+        tPackedFont packed;
+        tFont font;
+    } font;
+} AssetSlot;
+
+static const uint8_t* image_data;
+static size_t image_size;
+static const tAssetEntry* entries;
+static AssetSlot* slots;
+static int entry_count;
+
+#ifdef ESP_PLATFORM
+static const char* TAG = "assets";
+static spi_flash_mmap_handle_t image_handle;
+
+/**
+ *  @brief: map the whole partition with the label source
+ *  @return: NULL on success, what went wrong otherwise
+ */
+static const char* map_image(const char* source)
+{
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSET_PARTITION_SUBTYPE, source);
+    const void* data;
+
+    if (partition == NULL) {
+        return "partition not found";
+    }
+    if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &data, &image_handle) != ESP_OK) {
+        return "partition can not be mapped";
+    }
+    image_data = data;
+    image_size = partition->size;
+    return NULL;
+}
+
+static void unmap_image(void)
+{
+    spi_flash_munmap(image_handle);
+}
+#else
+/**
+ *  @brief: map the whole file at the path source
+ *  @return: NULL on success, what went wrong otherwise
+ */
+static const char* map_image(const char* source)
+{
+    struct stat st;
+    void* data;
+    int fd = open(source, O_RDONLY);
+
+    if (fd < 0) {
+        return "file can not be opened";
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return "file is empty";
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return "file can not be mapped";
+    }
+    image_data = data;
+    image_size = st.st_size;
+    return NULL;
+}
+
+static void unmap_image(void)
+{
+    munmap((void*)image_data, image_size);
+}
+#endif
+
+/**
+ *  @brief: walk the run lengths of an IMAGE_RLE bitmap like the drawing
+ *          code reads them, see tools/rle_assets.py
+ *  @return: 0 when they cover exactly pixels without reading past size
+ *           bytes, -1 otherwise
+ */
+static int check_rle_data(const uint8_t* data, size_t size, uint32_t pixels)
+{
+    size_t nibble = 0;
+    uint32_t covered = 0;
+
+    while (covered < pixels) {
+        uint32_t run;
+        int code;
+
+        if (nibble == 2 * size) {
+            return -1;
+        }
+        run = (data[nibble / 2] >> (nibble % 2 ? 0 : 4)) & 0x0F;
+        nibble++;
+        if (run == 0) {
+            int shift = 0;
+
+            do {
+                if (nibble == 2 * size || shift > 27) {
+                    return -1;
+                }
+                code = (data[nibble / 2] >> (nibble % 2 ? 0 : 4)) & 0x0F;
+                nibble++;
+                run |= (uint32_t)(code & 0x07) << shift;
+                shift += 3;
+            } while (code & 0x08);
+        }
+        if (run > pixels - covered) {
+            return -1;
+        }
+        covered += run;
+    }
+    return 0;
+}
+
+/**
+ *  @brief: check that the record of an entry lies inside the image and
+ *          make the tImage or tFont for it
+ *  @return: NULL on success, what is wrong with the entry otherwise
+ */
+static const char* load_entry(const tAssetEntry* entry, AssetSlot* slot, size_t size)
+{
+    const uint8_t* record = image_data + entry->offset;
+
+    if (memchr(entry->name, 0, ASSET_NAME_LENGTH) == NULL) {
+        return "name is not terminated";
+    }
+    if (entry->offset % 4 != 0 || entry->offset > size || entry->size > size - entry->offset) {
+        return "record is outside the image";
+    }
+
+    if (entry->type == ASSET_IMAGE) {
+        const tAssetImage* image = (const tAssetImage*)record;
+
+        if (entry->size < sizeof(tAssetImage)) {
+            return "image record is too short";
+        }
+        // raw rows take a byte for every dataSize pixels
+        if (image->compression == IMAGE_RAW
+            && (image->dataSize == 0
+                || (size_t)(image->width + image->dataSize - 1) / image->dataSize * image->height > entry->size - sizeof(tAssetImage))) {
+            return "image data is too short";
+        }
+        if (image->compression == IMAGE_RLE
+            && check_rle_data(record + sizeof(tAssetImage), entry->size - sizeof(tAssetImage), (uint32_t)image->width * image->height) != 0) {
+            return "image data is corrupt";
+        }
+        if (image->compression != IMAGE_RAW && image->compression != IMAGE_RLE) {
+            return "unknown compression";
+        }
+        if (image->left + image->width > image->full_width || image->top + image->height > image->full_height) {
+            return "image box is outside the image";
+        }
+        slot->image.data = record + sizeof(tAssetImage);
+        slot->image.width = image->width;
+        slot->image.height = image->height;
+        slot->image.dataSize = image->dataSize;
+        slot->image.compression = image->compression;
+        slot->image.left = image->left;
+        slot->image.top = image->top;
+        slot->image.full_width = image->full_width;
+        slot->image.full_height = image->full_height;
+        return NULL;
+    }
+
+    if (entry->type == ASSET_FONT) {
+        const tAssetFont* font = (const tAssetFont*)record;
+        size_t ranges = sizeof(tAssetFont);
+        size_t glyphs;
+        size_t kerning;
+        size_t atlas;
+        uint32_t bits;
+
+        if (entry->size < sizeof(tAssetFont)) {
+            return "font record is too short";
+        }
+        glyphs = ranges + font->range_count * sizeof(tFontRange);
+        kerning = glyphs + font->length * sizeof(tGlyph);
+        atlas = kerning + font->kerning_count * sizeof(tKernPair);
+        if (atlas > entry->size) {
+            return "font record is too short";
+        }
+        bits = (entry->size - atlas) * 8;
+        for (int i = 0; i < font->range_count; i++) {
+            const tFontRange* range = (const tFontRange*)(record + ranges) + i;
+
+            if (range->index < 0 || range->count < 0 || range->count > font->length - range->index) {
+                return "glyph range is outside the glyphs";
+            }
+        }
+        // the kerning pairs of a glyph end where those of the next start
+        for (int i = 0, first = 0; i < font->length; i++) {
+            const tGlyph* glyph = (const tGlyph*)(record + glyphs) + i;
+
+            if (glyph->kerning < first || glyph->kerning > font->kerning_count) {
+                return "kerning pairs are out of order";
+            }
+            if (glyph->offset > bits || (uint32_t)glyph->width * glyph->height > bits - glyph->offset) {
+                return "glyph bitmap is outside the atlas";
+            }
+            first = glyph->kerning;
+        }
+        for (int i = 0; i < font->kerning_count; i++) {
+            const tKernPair* pair = (const tKernPair*)(record + kerning) + i;
+
+            if (pair->right >= font->length) {
+                return "kerning pair is outside the glyphs";
+            }
+        }
+        slot->font.packed.length = font->length;
+        slot->font.packed.glyphs = (const tGlyph*)(record + glyphs);
+        slot->font.packed.atlas = record + atlas;
+        slot->font.packed.height = font->height;
+        slot->font.packed.baseline = font->baseline;
+        slot->font.packed.range_count = font->range_count;
+        slot->font.packed.ranges = (const tFontRange*)(record + ranges);
+        slot->font.packed.hash = font->hash;
+        slot->font.packed.kerning_count = font->kerning_count;
+        slot->font.packed.kerning = (const tKernPair*)(record + kerning);
+        memset(&slot->font.font, 0, sizeof(tFont));
+        slot->font.font.packed = &slot->font.packed;
+        return NULL;
+    }
+
+    return "unknown type";
+}
+
+/**
+ *  @brief: check the header and the index of the mapped image
+ *  @return: NULL on success, what is wrong with the image otherwise
+ */
+static const char* load_index(void)
+{
+    const tAssetHeader* header = (const tAssetHeader*)image_data;
+
+    if (image_size < sizeof(tAssetHeader) || header->magic != ASSET_MAGIC) {
+        return "no asset image";
+    }
+    if (header->version != ASSET_VERSION) {
+        return "asset image has another version";
+    }
+    if (header->size > image_size || sizeof(tAssetHeader) + header->count * sizeof(tAssetEntry) > header->size) {
+        return "asset image is truncated";
+    }
+
+    entries = (const tAssetEntry*)(image_data + sizeof(tAssetHeader));
+    entry_count = header->count;
+    slots = calloc(entry_count ? entry_count : 1, sizeof(AssetSlot));
+    if (slots == NULL) {
+        return "out of memory";
+    }
+    for (int i = 0; i < entry_count; i++) {
+        const char* error = load_entry(&entries[i], &slots[i], header->size);
+        if (error != NULL) {
+            return error;
+        }
+    }
+    return NULL;
+}
+
+int assets_open(const char* source)
+{
+    const char* error;
+
+    assets_close();
+    error = map_image(source);
+    if (error == NULL) {
+        error = load_index();
+        if (error != NULL) {
+            assets_close();
+        }
+    }
+    if (error != NULL) {
+#ifdef ESP_PLATFORM
+        ESP_LOGE(TAG, "%s: %s", source, error);
+#else
+        fprintf(stderr, "%s: %s\n", source, error);
+#endif
+        return -1;
+    }
+    return 0;
+}
+
+void assets_close(void)
+{
+    if (image_data != NULL) {
+        unmap_image();
+    }
+    free(slots);
+    image_data = NULL;
+    image_size = 0;
+    entries = NULL;
+    slots = NULL;
+    entry_count = 0;
+}
+
+/**
+ *  @brief: index of the entry with name and type, -1 when there is none
+ */
+static int find_entry(const char* name, uint32_t type)
+{
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].type == type && strcmp(entries[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const tImage* asset_image(const char* name)
+{
+    int index = find_entry(name, ASSET_IMAGE);
+
+    return index >= 0 ? &slots[index].image : NULL;
+}
+
+const tFont* asset_font(const char* name)
+{
+    int index = find_entry(name, ASSET_FONT);
+
+    return index >= 0 ? &slots[index].font.font : NULL;
+}
@@ -1,4 +1,6 @@
 #include "epd4in2b.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
 #include <stdlib.h>
 
 gpio_num_t reset_pin;
@@ -6,8 +8,24 @@ gpio_num_t dc_pin;
 gpio_num_t cs_pin;
 gpio_num_t busy_pin;
 
-unsigned int width;
-unsigned int height;
+static unsigned int width;
+static unsigned int height;
+
+// A frame sent and refreshed by display_task(), see display_changed_frame_async()
+// and display_banded_frame_async(). draw is NULL for a frame drawn on paint.
+typedef struct {
+    Paint paint;
+    EpdDrawFrame draw;
+    void* arg;
+    int with_red;
+    FrameHistory* history;
+    int sleep_after;
+    int queued; // set until epd_wait_idle() took the result
+    int result;
+} DisplayJob;
+
+static EventGroupHandle_t events;
+static DisplayJob job;
 
 int epd4in2b_init(void)
 {
@@ -18,6 +36,14 @@ int epd4in2b_init(void)
     width = EPD_WIDTH;
     height = EPD_HEIGHT;
 
+    if (events == NULL) {
+        events = xEventGroupCreate();
+        if (events == NULL) {
+            return -1;
+        }
+        xEventGroupSetBits(events, EPD_IDLE_BIT);
+    }
+
     /* this calls the peripheral hardware interface, see epdif */
     if (ifinit() != 0) {
         return -1;
@@ -29,7 +55,9 @@ int epd4in2b_init(void)
     send_data(0x17);
     send_data(0x17); //07 0f 17 1f 27 2F 37 2f
     send_command(POWER_ON);
-    wait_untile_idle();
+    if (wait_untile_idle() != 0) {
+        return -1;
+    }
     send_command(PANEL_SETTING);
     send_data(0x0F); // LUT from OTP
     /* EPD hardware init end */
@@ -42,6 +70,8 @@ int epd4in2b_init(void)
  */
 void send_command(unsigned char command)
 {
+    // the data before the command may still be on its way
+    spi_wait();
     digital_write(dc_pin, 0);
     spi_transfer(command);
 }
@@ -56,13 +86,35 @@ void send_data(unsigned char data)
 }
 
 /**
- *  @brief: Wait until the busy_pin goes HIGH
+ *  @brief: send a block of data in a few queued DMA transactions, with DC
+ *          set once. data has to stay as it is until the next command.
+ */
+static void send_data_block(const unsigned char* data, int length)
+{
+    digital_write(dc_pin, 1);
+    spi_write(data, length);
+}
+
+/**
+ *  @brief: send length bytes of value as data, with DC set once
  */
-void wait_untile_idle(void)
+static void send_data_fill(unsigned char value, int length)
 {
-    while (digital_read(busy_pin) == 0) { //0: busy, 1: idle
-        delay_ms(100);
+    digital_write(dc_pin, 1);
+    spi_fill(value, length);
+}
+
+/**
+ *  @brief: Wait until the busy_pin goes HIGH, at most BUSY_TIMEOUT_MS
+ *  @return: 0 when the display is idle, -1 when it hangs
+ */
+int wait_untile_idle(void)
+{
+    if (wait_busy_released(BUSY_TIMEOUT_MS) != 0) {
+        ESP_LOGE("EPD", "still busy after %d ms", BUSY_TIMEOUT_MS);
+        return -1;
     }
+    return 0;
 }
 
 /**
@@ -79,16 +131,14 @@ void reset(void)
 }
 
 /**
- * @brief Transmit partial data to the SRAM
+ * @brief Enter partial mode and select the window the next data is written to
  * 
- * @param char 
- * @param char 
- * @param x 
+ * @param x should be a multiple of 8
  * @param y 
- * @param w 
+ * @param w should be a multiple of 8
  * @param l 
  */
-void set_partial_window(const unsigned char* buffer_black, const unsigned char* buffer_red, int x, int y, int w, int l)
+static void send_partial_window(int x, int y, int w, int l)
 {
     send_command(PARTIAL_IN);
     send_command(PARTIAL_WINDOW);
@@ -102,18 +152,41 @@ void set_partial_window(const unsigned char* buffer_black, const unsigned char*
     send_data((y + l - 1) & 0xff);
     send_data(0x01); // Gates scan both inside and outside of the partial window. (default)
     delay_ms(2);
+}
+
+/**
+ * @brief Transmit a window of a full frame buffer, row by row
+ * 
+ * @param frame Pointer to the frame buffer
+ * @param stride Bytes per row of the frame buffer
+ */
+static void send_frame_window(const unsigned char* frame, int stride, int x, int y, int w, int l)
+{
+    digital_write(dc_pin, 1);
+    spi_write_rows(frame + y * stride + x / 8, stride, w / 8, l);
+}
+
+/**
+ * @brief Transmit partial data to the SRAM
+ * 
+ * @param char 
+ * @param char 
+ * @param x 
+ * @param y 
+ * @param w 
+ * @param l 
+ */
+void set_partial_window(const unsigned char* buffer_black, const unsigned char* buffer_red, int x, int y, int w, int l)
+{
+    send_partial_window(x, y, w, l);
     send_command(DATA_START_TRANSMISSION_1);
     if (buffer_black != NULL) {
-        for (int i = 0; i < w / 8 * l; i++) {
-            send_data(buffer_black[i]);
-        }
+        send_data_block(buffer_black, w / 8 * l);
     }
     delay_ms(2);
     send_command(DATA_START_TRANSMISSION_2);
     if (buffer_red != NULL) {
-        for (int i = 0; i < w / 8 * l; i++) {
-            send_data(buffer_red[i]);
-        }
+        send_data_block(buffer_red, w / 8 * l);
     }
     delay_ms(2);
     send_command(PARTIAL_OUT);
@@ -124,23 +197,10 @@ void set_partial_window(const unsigned char* buffer_black, const unsigned char*
  */
 void set_partial_window_black(const unsigned char* buffer_black, int x, int y, int w, int l)
 {
-    send_command(PARTIAL_IN);
-    send_command(PARTIAL_WINDOW);
-    send_data(x >> 8);
-    send_data(x & 0xf8); // x should be the multiple of 8, the last 3 bit will always be ignored
-    send_data(((x & 0xf8) + w - 1) >> 8);
-    send_data(((x & 0xf8) + w - 1) | 0x07);
-    send_data(y >> 8);
-    send_data(y & 0xff);
-    send_data((y + l - 1) >> 8);
-    send_data((y + l - 1) & 0xff);
-    send_data(0x01); // Gates scan both inside and outside of the partial window. (default)
-    delay_ms(2);
+    send_partial_window(x, y, w, l);
     send_command(DATA_START_TRANSMISSION_1);
     if (buffer_black != NULL) {
-        for (int i = 0; i < w / 8 * l; i++) {
-            send_data(buffer_black[i]);
-        }
+        send_data_block(buffer_black, w / 8 * l);
     }
     delay_ms(2);
     send_command(PARTIAL_OUT);
@@ -157,54 +217,324 @@ void set_partial_window_black(const unsigned char* buffer_black, int x, int y, i
  */
 void set_partial_window_red(const unsigned char* buffer_red, int x, int y, int w, int l)
 {
-    send_command(PARTIAL_IN);
-    send_command(PARTIAL_WINDOW);
-    send_data(x >> 8);
-    send_data(x & 0xf8); // x should be the multiple of 8, the last 3 bit will always be ignored
-    send_data(((x & 0xf8) + w - 1) >> 8);
-    send_data(((x & 0xf8) + w - 1) | 0x07);
-    send_data(y >> 8);
-    send_data(y & 0xff);
-    send_data((y + l - 1) >> 8);
-    send_data((y + l - 1) & 0xff);
-    send_data(0x01); // Gates scan both inside and outside of the partial window. (default)
-    delay_ms(2);
+    send_partial_window(x, y, w, l);
     send_command(DATA_START_TRANSMISSION_2);
     if (buffer_red != NULL) {
-        for (int i = 0; i < w / 8 * l; i++) {
-            send_data(buffer_red[i]);
-        }
+        send_data_block(buffer_red, w / 8 * l);
     }
     delay_ms(2);
     send_command(PARTIAL_OUT);
 }
 
+/**
+ * @brief Transmit the dirty rectangles of a canvas to SRAM, the black plane
+ *        and the red one if it has one through the same partial windows
+ * 
+ * @param paint Canvas covering the whole display
+ */
+static void send_dirty_windows(Paint* paint)
+{
+    PaintRect whole = { 0, 0, paint->width, paint->height };
+    const PaintRect* rects = paint->dirty;
+    int count = paint->dirty_count;
+    int area = 0;
+
+    for (int i = 0; i < count; i++) {
+        area += paint->dirty[i].width * paint->dirty[i].height;
+    }
+    // Overlapping windows can add up to more than the frame itself
+    if (area >= whole.width * whole.height) {
+        rects = &whole;
+        count = 1;
+    }
+    for (int i = 0; i < count; i++) {
+        const PaintRect* rect = &rects[i];
+        send_partial_window(rect->x, rect->y, rect->width, rect->height);
+        send_command(DATA_START_TRANSMISSION_1);
+        send_frame_window(paint->image, paint->width / 8, rect->x, rect->y, rect->width, rect->height);
+        delay_ms(2);
+        if (paint->image_red != NULL) {
+            send_command(DATA_START_TRANSMISSION_2);
+            send_frame_window(paint->image_red, paint->width / 8, rect->x, rect->y, rect->width, rect->height);
+            delay_ms(2);
+        }
+        send_command(PARTIAL_OUT);
+    }
+    paint_clear_dirty(paint);
+}
+
+/**
+ * @brief Transmit only what was drawn on the canvas since its dirty 
+ *        rectangles were last cleared, then refresh the display. Nothing is
+ *        refreshed when nothing was drawn. A canvas that is cleared and
+ *        redrawn is dirty all over; compare it with display_changed_frame()
+ *        instead.
+ * 
+ * @param paint Canvas of the black frame, with the red frame as its second
+ *        plane or without one
+ * @return int 0, or -1 when the display hangs
+ */
+int display_dirty_frame(Paint* paint)
+{
+    int dirty_count = paint->dirty_count;
+
+    send_dirty_windows(paint);
+    return dirty_count > 0 ? refresh_display() : 0;
+}
+
 /**
  * @brief Refresh and displays the frame
  * 
  * @param char Pointer to black frame buffer
  * @param char Pointer to red frame buffer
+ * @return int 0, or -1 when the display hangs
  */
-void display_frame(const unsigned char* frame_black, const unsigned char* frame_red)
+int display_frame(const unsigned char* frame_black, const unsigned char* frame_red)
 {
     if (frame_black != NULL) {
         send_command(DATA_START_TRANSMISSION_1);
         delay_ms(2);
-        for (int i = 0; i < width / 8 * height; i++) {
-            send_data(frame_black[i]);
-        }
+        send_data_block(frame_black, width / 8 * height);
         delay_ms(2);
     }
     if (frame_red != NULL) {
         send_command(DATA_START_TRANSMISSION_2);
         delay_ms(2);
-        for (int i = 0; i < width / 8 * height; i++) {
-            send_data(frame_red[i]);
+        send_data_block(frame_red, width / 8 * height);
+        delay_ms(2);
+    }
+    // BUSY only goes low a while after the refresh command
+    return refresh_display();
+}
+
+/**
+ * @brief FNV-1a hash of a band of rows of a frame buffer
+ * 
+ * @param hash Hash so far, to hash more than one plane into one band
+ */
+static uint32_t hash_frame_rows(uint32_t hash, const unsigned char* frame, int y, int l)
+{
+    const unsigned char* data = frame + y * (width / 8);
+
+    for (int i = 0; i < width / 8 * l; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Refresh the display only where the canvas differs from what it
+ *        showed before, according to the band hashes in history.
+ *        The first frame, without valid history, is sent in full, both
+ *        planes, the red one as paper without a red frame, so SRAM does not
+ *        have to be cleared before. Later frames send the rows
+ *        from the first to the last changed band and refresh just those, or
+ *        nothing at all when no band changed.
+ * 
+ * @param paint Canvas of the black frame, with the red frame as its second
+ *        plane or without one
+ * @param history Band hashes of the frame on the display, updated afterwards
+ * @return int Number of bands that changed, -1 when the display hangs. The
+ *         history is invalid then, the next frame is sent in full.
+ */
+int display_changed_frame(Paint* paint, FrameHistory* history)
+{
+    int first = -1;
+    int last = -1;
+
+    for (int band = 0; band < EPD_FRAME_BANDS; band++) {
+        int y = band * EPD_FRAME_BAND_ROWS;
+        int l = height - y < EPD_FRAME_BAND_ROWS ? height - y : EPD_FRAME_BAND_ROWS;
+        uint32_t hash = hash_frame_rows(2166136261u, paint->image, y, l);
+
+        if (paint->image_red != NULL) {
+            hash = hash_frame_rows(hash, paint->image_red, y, l);
+        }
+        if (!history->valid || history->bands[band] != hash) {
+            if (first < 0) {
+                first = band;
+            }
+            last = band;
+            history->bands[band] = hash;
+        }
+    }
+
+    if (!history->valid) {
+        send_command(DATA_START_TRANSMISSION_1);
+        send_data_block(paint->image, width / 8 * height);
+        delay_ms(2);
+        send_command(DATA_START_TRANSMISSION_2);
+        if (paint->image_red != NULL) {
+            send_data_block(paint->image_red, width / 8 * height);
+        } else {
+            send_data_fill(0xFF, width / 8 * height);
         }
         delay_ms(2);
+        paint_clear_dirty(paint);
+        history->valid = refresh_display() == 0;
+        return history->valid ? EPD_FRAME_BANDS : -1;
     }
-    send_command(DISPLAY_REFRESH);
-    wait_untile_idle();
+
+    if (first >= 0) {
+        int y = first * EPD_FRAME_BAND_ROWS;
+        int l = (last + 1) * EPD_FRAME_BAND_ROWS;
+
+        l = (l < height ? l : height) - y;
+        send_partial_window(0, y, width, l);
+        send_command(DATA_START_TRANSMISSION_1);
+        send_frame_window(paint->image, width / 8, 0, y, width, l);
+        delay_ms(2);
+        if (paint->image_red != NULL) {
+            send_command(DATA_START_TRANSMISSION_2);
+            send_frame_window(paint->image_red, width / 8, 0, y, width, l);
+            delay_ms(2);
+        }
+        // Refreshing in partial mode only drives the window
+        if (refresh_display() != 0) {
+            history->valid = 0;
+        }
+        send_command(PARTIAL_OUT);
+    }
+    paint_clear_dirty(paint);
+
+    if (!history->valid) {
+        return -1;
+    }
+    return first < 0 ? 0 : last - first + 1;
+}
+
+/**
+ * @brief Draw band of a frame into the planes at buffer, the red one
+ *        plane_size bytes after the black one
+ * 
+ * @return uint32_t Hash of the band, like display_changed_frame() has it
+ */
+static uint32_t draw_band(Paint* paint, EpdDrawFrame draw, void* arg, unsigned char* buffer, int plane_size, int with_red, int band)
+{
+    uint32_t hash;
+
+    paint_set_band(paint, buffer, with_red ? buffer + plane_size : NULL, band * EPD_FRAME_BAND_ROWS, EPD_FRAME_BAND_ROWS);
+    draw(paint, arg);
+    hash = hash_frame_rows(2166136261u, paint->image, 0, paint->rows);
+    if (paint->image_red != NULL) {
+        hash = hash_frame_rows(hash, paint->image_red, 0, paint->rows);
+    }
+    return hash;
+}
+
+/**
+ * @brief Draw a frame band by band into two small buffers and stream each
+ *        band to SRAM while the next one is drawn, then refresh the display
+ *        like display_changed_frame() does. A band is as high as the bands
+ *        of history.
+ *        Without valid history every band is sent and the whole display
+ *        refreshed, SRAM does not have to be cleared before: both planes of
+ *        every band are written, the red one with paper when with_red is 0. Otherwise the
+ *        bands are drawn once to find the ones that changed, and only the
+ *        bands from the first to the last changed one are sent and
+ *        refreshed. The first changed band is kept from that pass, the ones
+ *        after it up to the last changed band are drawn again. Nothing is
+ *        sent when no band changed.
+ *        Only two bands are held at a time, 2 KB per plane instead of the
+ *        15 KB of a whole plane that display_changed_frame() is given.
+ * 
+ * @param draw Draws the whole frame on the canvas it gets, once or twice
+ *        per band. The canvas only keeps the rows of the band, draw has to
+ *        draw the same frame every time.
+ * @param arg Passed to draw
+ * @param with_red Whether the canvas has a red plane
+ * @param history Band hashes of the frame on the display, updated afterwards
+ * @return int Number of bands that changed, -1 when the display hangs or
+ *         the buffers can not be allocated
+ */
+int display_banded_frame(EpdDrawFrame draw, void* arg, int with_red, FrameHistory* history)
+{
+    int plane_size = width / 8 * EPD_FRAME_BAND_ROWS;
+    int buffer_size = (with_red ? 2 : 1) * plane_size;
+    unsigned char* buffers = (unsigned char*)heap_caps_malloc(2 * buffer_size, MALLOC_CAP_DMA);
+    int first = 0;
+    int last = EPD_FRAME_BANDS - 1;
+    uint32_t hash;
+    Paint paint;
+
+    if (buffers == NULL) {
+        ESP_LOGE("EPD", "no memory for the frame bands");
+        return -1;
+    }
+    paint_init_planes(&paint, NULL, NULL, width, height);
+
+    if (history->valid) {
+        // The first changed band stays in the first buffer, the bands
+        // after it are only hashed in the second one
+        unsigned char* buffer = buffers;
+
+        first = -1;
+        for (int band = 0; band < EPD_FRAME_BANDS; band++) {
+            uint32_t band_hash = draw_band(&paint, draw, arg, buffer, plane_size, with_red, band);
+
+            if (band_hash != history->bands[band]) {
+                if (first < 0) {
+                    first = band;
+                    hash = band_hash;
+                    buffer = buffers + buffer_size;
+                }
+                last = band;
+            }
+        }
+        if (first < 0) {
+            free(buffers);
+            return 0;
+        }
+        paint_set_band(&paint, buffers, with_red ? buffers + plane_size : NULL, first * EPD_FRAME_BAND_ROWS, EPD_FRAME_BAND_ROWS);
+    } else {
+        hash = draw_band(&paint, draw, arg, buffers, plane_size, with_red, first);
+    }
+    for (int band = first; band <= last; band++) {
+        const unsigned char* black = paint.image;
+        const unsigned char* red = paint.image_red;
+        int y = paint.top;
+        int l = paint.rows;
+
+        history->bands[band] = hash;
+        send_partial_window(0, y, width, l);
+        send_command(DATA_START_TRANSMISSION_1);
+        send_data_block(black, width / 8 * l);
+        delay_ms(2);
+        send_command(DATA_START_TRANSMISSION_2);
+        if (red != NULL) {
+            send_data_block(red, width / 8 * l);
+        } else {
+            // whatever is in the red SRAM would be refreshed as well
+            send_data_fill(0xFF, width / 8 * l);
+        }
+        // The next band is drawn into the other buffer while this one is
+        // still on its way to SRAM
+        if (band < last) {
+            hash = draw_band(&paint, draw, arg, buffers + ((band + 1 - first) & 1) * buffer_size, plane_size, with_red, band + 1);
+        }
+        delay_ms(2);
+        send_command(PARTIAL_OUT);
+    }
+    free(buffers);
+
+    if (!history->valid) {
+        history->valid = refresh_display() == 0;
+        return history->valid ? EPD_FRAME_BANDS : -1;
+    }
+
+    int y = first * EPD_FRAME_BAND_ROWS;
+    int l = (last + 1) * EPD_FRAME_BAND_ROWS;
+
+    l = (l < height ? l : height) - y;
+    send_partial_window(0, y, width, l);
+    // Refreshing in partial mode only drives the window
+    if (refresh_display() != 0) {
+        history->valid = 0;
+    }
+    send_command(PARTIAL_OUT);
+
+    return history->valid ? last - first + 1 : -1;
 }
 
 /**
@@ -215,26 +545,23 @@ void clear_frame(void)
 {
     send_command(DATA_START_TRANSMISSION_1);
     delay_ms(2);
-    for (int i = 0; i < width / 8 * height; i++) {
-        send_data(0xFF);
-    }
+    send_data_fill(0xFF, width / 8 * height);
     delay_ms(2);
     send_command(DATA_START_TRANSMISSION_2);
     delay_ms(2);
-    for (int i = 0; i < width / 8 * height; i++) {
-        send_data(0xFF);
-    }
+    send_data_fill(0xFF, width / 8 * height);
     delay_ms(2);
 }
 
 /**
  * @brief: This displays the frame data from SRAM
+ * @return: 0, or -1 when the display hangs
  */
-void refresh_display(void)
+int refresh_display(void)
 {
     send_command(DISPLAY_REFRESH);
     delay_ms(100);
-    wait_untile_idle();
+    return wait_untile_idle();
 }
 
 /**
@@ -248,9 +575,114 @@ void epd4in2_sleep()
     send_command(VCOM_AND_DATA_INTERVAL_SETTING);
     send_data(0xF7); // border floating
     send_command(POWER_OFF);
+    // a display that hangs is put to sleep all the same
     wait_untile_idle();
     send_command(DEEP_SLEEP);
     send_data(0xA5); // check code
 }
 
+static void display_task(void* pvParameters)
+{
+    if (job.draw != NULL) {
+        job.result = display_banded_frame(job.draw, job.arg, job.with_red, job.history);
+    } else {
+        job.result = display_changed_frame(&job.paint, job.history);
+    }
+    if (job.sleep_after) {
+        epd4in2_sleep();
+    }
+    xEventGroupSetBits(events, EPD_IDLE_BIT | (job.result < 0 ? EPD_FAULT_BIT : 0));
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Start display_changed_frame() in a task of its own and return
+ *        right away. EPD_IDLE_BIT of epd_events() is set when the frame is
+ *        on the display, and the display is asleep if sleep_after is set.
+ *        The canvas is copied, its frame buffers and history have to stay
+ *        as they are until then.
+ * 
+ * @return int 0 when the frame is being sent, -1 when the display is not
+ *         idle or the task can not be started
+ */
+int display_changed_frame_async(Paint* paint, FrameHistory* history, int sleep_after)
+{
+    if (events == NULL || !(xEventGroupGetBits(events) & EPD_IDLE_BIT)) {
+        return -1;
+    }
+    xEventGroupClearBits(events, EPD_IDLE_BIT | EPD_FAULT_BIT);
+    job.paint = *paint;
+    paint_clear_dirty(paint);
+    job.draw = NULL;
+    job.history = history;
+    job.sleep_after = sleep_after;
+    job.queued = 1;
+    job.result = -1;
+    if (xTaskCreate(&display_task, "epd_display_task", 3072, NULL, 5, NULL) != pdPASS) {
+        job.queued = 0;
+        xEventGroupSetBits(events, EPD_IDLE_BIT | EPD_FAULT_BIT);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Start display_banded_frame() in a task of its own and return right
+ *        away, see display_changed_frame_async(). draw runs in that task,
+ *        what it draws from has to stay as it is until EPD_IDLE_BIT is set.
+ * 
+ * @return int 0 when the frame is being drawn and sent, -1 when the display
+ *         is not idle or the task can not be started
+ */
+int display_banded_frame_async(EpdDrawFrame draw, void* arg, int with_red, FrameHistory* history, int sleep_after)
+{
+    if (events == NULL || !(xEventGroupGetBits(events) & EPD_IDLE_BIT)) {
+        return -1;
+    }
+    xEventGroupClearBits(events, EPD_IDLE_BIT | EPD_FAULT_BIT);
+    job.draw = draw;
+    job.arg = arg;
+    job.with_red = with_red;
+    job.history = history;
+    job.sleep_after = sleep_after;
+    job.queued = 1;
+    job.result = -1;
+    // draw gets the stack of the task
+    if (xTaskCreate(&display_task, "epd_display_task", 8192, NULL, 5, NULL) != pdPASS) {
+        job.queued = 0;
+        xEventGroupSetBits(events, EPD_IDLE_BIT | EPD_FAULT_BIT);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Event group with EPD_IDLE_BIT and EPD_FAULT_BIT, to wait for the
+ *        display together with other events. NULL before epd4in2b_init().
+ */
+EventGroupHandle_t epd_events(void)
+{
+    return events;
+}
+
+/**
+ * @brief Wait until the frame started by display_changed_frame_async() or
+ *        display_banded_frame_async() is on the display, at most timeout_ms
+ * 
+ * @return int What display_changed_frame() or display_banded_frame()
+ *         returned for it, -1 on a timeout or when no frame was started
+ *         since the last wait
+ */
+int epd_wait_idle(unsigned int timeout_ms)
+{
+    if (events == NULL || !job.queued) {
+        return -1;
+    }
+    if (!(xEventGroupWaitBits(events, EPD_IDLE_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms)) & EPD_IDLE_BIT)) {
+        return -1;
+    }
+    job.queued = 0;
+    return job.result;
+}
+
 /* END OF FILE */
@@ -26,7 +26,28 @@
  */
 
 #include "epdif.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "soc/soc_memory_layout.h"
+
+// Task waiting in wait_busy_released(), notified by the BUSY interrupt
+static TaskHandle_t busy_task;
+
+/*
+ * Bulk data goes out in queued DMA transactions of up to SPI_CHUNK_SIZE
+ * bytes, so the CPU is free while a frame plane is sent. Transactions finish
+ * in the order they were queued and are numbered, queued counts the ones
+ * queued so far and done the ones whose results were taken back.
+ */
+static spi_transaction_t transactions[SPI_QUEUE_SIZE];
+static uint32_t queued;
+static uint32_t done;
+
+// DMA capable buffers for data that is not contiguous in memory, one is
+// filled while the other is sent
+static unsigned char* staging[2];
+static uint32_t staging_use[2]; // number of the last transaction sending it
+static int next_staging;
 
 void digital_write(gpio_num_t pin, int value)
 {
@@ -45,6 +66,175 @@ void delay_ms(unsigned int delaytime)
     vTaskDelay(delaytime / portTICK_RATE_MS);
 }
 
+static void IRAM_ATTR busy_released_isr(void* arg)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (busy_task != NULL) {
+        vTaskNotifyGiveFromISR(busy_task, &woken);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/**
+ *  @brief: sleep until the rising edge of BUSY_PIN, when the display is
+ *          idle again, or until timeout_ms passed
+ *  @return: 0 when the display is idle, -1 when it is still busy
+ */
+int wait_busy_released(unsigned int timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    int result = 0;
+
+    busy_task = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+    gpio_intr_enable(BUSY_PIN);
+    // the level is read after enabling the interrupt, so no edge is missed
+    while (gpio_get_level(BUSY_PIN) == 0) { //0: busy, 1: idle
+        TickType_t elapsed = xTaskGetTickCount() - start;
+
+        if (elapsed >= timeout) {
+            result = -1;
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+    }
+    gpio_intr_disable(BUSY_PIN);
+    busy_task = NULL;
+
+    return result;
+}
+
+/**
+ *  @brief: take back the result of the oldest queued transaction
+ */
+static void finish_transaction(void)
+{
+    spi_transaction_t* t;
+
+    ESP_ERROR_CHECK(spi_device_get_trans_result(spi, &t, portMAX_DELAY));
+    done++;
+}
+
+/**
+ *  @brief: queue a transaction of length bytes from a DMA capable buffer,
+ *          that has to stay as it is until the transaction is done
+ *  @return: the number of the transaction
+ */
+static uint32_t queue_transaction(const unsigned char* data, int length)
+{
+    spi_transaction_t* t;
+
+    if (queued - done == SPI_QUEUE_SIZE) {
+        finish_transaction();
+    }
+    t = &transactions[queued % SPI_QUEUE_SIZE];
+    memset(t, 0, sizeof(spi_transaction_t));
+    t->length = length * 8; // transaction length is in bits
+    t->tx_buffer = data;
+    ESP_ERROR_CHECK(spi_device_queue_trans(spi, t, portMAX_DELAY));
+    return queued++;
+}
+
+/**
+ *  @brief: a staging buffer that is not sent anymore
+ */
+static unsigned char* take_staging(void)
+{
+    int index = next_staging;
+
+    next_staging = !next_staging;
+    while ((int32_t)(done - staging_use[index]) <= 0 && done != queued) {
+        finish_transaction();
+    }
+    return staging[index];
+}
+
+static void queue_staging(unsigned char* buffer, int length)
+{
+    staging_use[buffer == staging[1]] = queue_transaction(buffer, length);
+}
+
+/**
+ *  @brief: wait until all queued data is sent, the DC pin may only change
+ *          after that
+ */
+void spi_wait(void)
+{
+    while (done != queued) {
+        finish_transaction();
+    }
+}
+
+/**
+ *  @brief: queue length bytes in chunks. data in DMA capable memory is sent
+ *          where it is and has to stay as it is until spi_wait(), other
+ *          data (flash, PSRAM, unaligned) is copied to the staging buffers
+ */
+void spi_write(const unsigned char* data, int length)
+{
+    int direct = esp_ptr_dma_capable(data) && (uintptr_t)data % 4 == 0;
+
+    while (length > 0) {
+        int chunk = length < SPI_CHUNK_SIZE ? length : SPI_CHUNK_SIZE;
+
+        if (direct) {
+            queue_transaction(data, chunk);
+        } else {
+            unsigned char* buffer = take_staging();
+
+            memcpy(buffer, data, chunk);
+            queue_staging(buffer, chunk);
+        }
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+/**
+ *  @brief: queue rows of row_length bytes that are stride bytes apart,
+ *          gathered into the staging buffers as many rows at a time as fit
+ */
+void spi_write_rows(const unsigned char* data, int stride, int row_length, int rows)
+{
+    int rows_per_chunk = SPI_CHUNK_SIZE / row_length;
+
+    if (row_length == stride) {
+        spi_write(data, row_length * rows);
+        return;
+    }
+    while (rows > 0) {
+        int count = rows < rows_per_chunk ? rows : rows_per_chunk;
+        unsigned char* buffer = take_staging();
+
+        for (int i = 0; i < count; i++) {
+            memcpy(buffer + i * row_length, data, row_length);
+            data += stride;
+        }
+        queue_staging(buffer, count * row_length);
+        rows -= count;
+    }
+}
+
+/**
+ *  @brief: queue length bytes of value, all chunks are sent from one buffer
+ */
+void spi_fill(unsigned char value, int length)
+{
+    unsigned char* buffer = take_staging();
+
+    memset(buffer, value, length < SPI_CHUNK_SIZE ? length : SPI_CHUNK_SIZE);
+    while (length > 0) {
+        int chunk = length < SPI_CHUNK_SIZE ? length : SPI_CHUNK_SIZE;
+
+        queue_staging(buffer, chunk);
+        length -= chunk;
+    }
+}
+
 void spi_transfer(unsigned char data)
 {
     esp_err_t ret;
@@ -57,6 +247,8 @@ void spi_transfer(unsigned char data)
         .tx_data[3] = data
     };
 
+    // spi_device_transmit() would take the result of a queued transaction
+    spi_wait();
     ret = spi_device_transmit(spi, &t); //Transmit!
     assert(ret == ESP_OK); //Should have had no issues.
 }
@@ -74,7 +266,7 @@ int ifinit(void)
     ESP_ERROR_CHECK(gpio_config(&io_conf));
 
     gpio_config_t i_conf = {
-        .intr_type = GPIO_INTR_DISABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
         .mode = GPIO_MODE_INPUT,
         .pin_bit_mask = ((uint64_t)1 << (uint64_t)BUSY_PIN),
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
@@ -83,6 +275,14 @@ int ifinit(void)
 
     ESP_ERROR_CHECK(gpio_config(&i_conf));
 
+    // BUSY interrupts are only enabled while a task waits for them
+    esp_err_t isr_ret = gpio_install_isr_service(0);
+    if (isr_ret != ESP_ERR_INVALID_STATE) { // the service was installed before
+        ESP_ERROR_CHECK(isr_ret);
+    }
+    gpio_intr_disable(BUSY_PIN);
+    ESP_ERROR_CHECK(gpio_isr_handler_add(BUSY_PIN, busy_released_isr, NULL));
+
     // gpio_set_direction(DC_PIN, GPIO_MODE_OUTPUT);
     // gpio_set_direction(RST_PIN, GPIO_MODE_OUTPUT);
     // gpio_set_direction(BUSY_PIN, GPIO_MODE_INPUT);
@@ -95,10 +295,11 @@ int ifinit(void)
         .sclk_io_num = CLK_PIN,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
+        .max_transfer_sz = SPI_CHUNK_SIZE,
     };
 
-    //Initialize the SPI bus
-    ret = spi_bus_initialize(HSPI_HOST, &buscfg, 0);
+    //Initialize the SPI bus, with DMA channel 1 for the bulk transfers
+    ret = spi_bus_initialize(HSPI_HOST, &buscfg, 1);
     switch (ret) {
     case ESP_ERR_INVALID_ARG:
         ESP_LOGE("EPDIF", "INVALID ARG");
@@ -118,15 +319,25 @@ int ifinit(void)
         .command_bits = 0,
         .address_bits = 0,
         .dummy_bits = 0,
-        .clock_speed_hz = 2 * 1000 * 1000,
+        .clock_speed_hz = SPI_CLOCK_HZ,
         .mode = 0,
         .spics_io_num = CS_PIN,
-        .queue_size = 1
+        .queue_size = SPI_QUEUE_SIZE
     };
 
     //Attach the EPD to the SPI bus
     ret = spi_bus_add_device(HSPI_HOST, &devcfg, &spi);
     assert(ret == ESP_OK);
 
+    for (int i = 0; i < 2; i++) {
+        if (staging[i] == NULL) {
+            staging[i] = heap_caps_malloc(SPI_CHUNK_SIZE, MALLOC_CAP_DMA);
+        }
+        if (staging[i] == NULL) {
+            ESP_LOGE("EPDIF", "no DMA memory for the staging buffers");
+            return -1;
+        }
+    }
+
     return 0;
 }
@@ -1,289 +1,1801 @@
 #include "epdpaint.h"
+#include <stdint.h>
 
-unsigned char* image;
-int width;
-int height;
-int rotate;
+/**
+ *  @brief: set up a canvas drawing into image
+ */
+void paint_init(Paint* paint, unsigned char* image, int width, int height)
+{
+    paint_init_planes(paint, image, NULL, width, height);
+}
+
+/**
+ *  @brief: set up a canvas drawing black into image_black and red into
+ *          image_red, both buffers of the same size
+ */
+void paint_init_planes(Paint* paint, unsigned char* image_black, unsigned char* image_red, int width, int height)
+{
+    paint->image = image_black;
+    paint->image_red = image_red;
+    /* 1 byte = 8 pixels, so the width should be the multiple of 8 */
+    paint->width = width % 8 ? width + 8 - (width % 8) : width;
+    paint->height = height;
+    paint->top = 0;
+    paint->rows = height;
+    paint->dirty_count = 0;
+    paint->text_cache = NULL;
+}
+
+/**
+ *  @brief: let the canvas hold only the rows from top of the frame, rows
+ *          of them in image_black and image_red. what is drawn outside
+ *          them is left out, the same drawing is done again for every band
+ *          of the frame. the dirty rectangles are cleared.
+ */
+void paint_set_band(Paint* paint, unsigned char* image_black, unsigned char* image_red, int top, int rows)
+{
+    paint->image = image_black;
+    paint->image_red = image_red;
+    paint->top = top;
+    paint->rows = top + rows > paint->height ? paint->height - top : rows;
+    paint->dirty_count = 0;
+}
+
+/**
+ *  @brief: draw strings from cache and keep the ones drawn again in it
+ */
+void paint_set_text_cache(Paint* paint, TextCache* cache)
+{
+    paint->text_cache = cache;
+}
+
+/**
+ *  @brief: forget the dirty rectangles, e.g. after they were sent to the display
+ */
+void paint_clear_dirty(Paint* paint)
+{
+    paint->dirty_count = 0;
+}
+
+static inline int rect_area(const PaintRect* rect)
+{
+    return rect->width * rect->height;
+}
+
+/**
+ *  @brief: the bounding box of two rectangles
+ */
+static inline PaintRect rect_union(const PaintRect* a, const PaintRect* b)
+{
+    PaintRect result;
+    int right = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+    int bottom = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+
+    result.x = a->x < b->x ? a->x : b->x;
+    result.y = a->y < b->y ? a->y : b->y;
+    result.width = right - result.x;
+    result.height = bottom - result.y;
+    return result;
+}
+
+/**
+ *  @brief: the number of pixels sending the bounding box of two rectangles
+ *          costs more than sending both of them
+ */
+static inline int rect_merge_waste(const PaintRect* a, const PaintRect* b)
+{
+    PaintRect merged = rect_union(a, b);
+
+    return rect_area(&merged) - rect_area(a) - rect_area(b);
+}
+
+/**
+ *  @brief: record that a rectangle by absolute coordinates was drawn.
+ *          the rectangle is widened to whole bytes and merged with the
+ *          recorded rectangles when that adds little area. if all
+ *          PAINT_MAX_DIRTY_RECTS are in use, the two rectangles that are
+ *          the cheapest to combine are merged.
+ */
+void paint_mark_dirty(Paint* paint, int x, int y, int rect_width, int rect_height)
+{
+    PaintRect rect;
+    int right = x + rect_width;
+    int bottom = y + rect_height;
+
+    x = x < 0 ? 0 : x & ~7;
+    y = y < paint->top ? paint->top : y;
+    right = right > paint->width ? paint->width : (right + 7) & ~7;
+    bottom = bottom > paint->top + paint->rows ? paint->top + paint->rows : bottom;
+    if (right <= x || bottom <= y) {
+        return;
+    }
+    /* pixels drawn one by one mostly land in the rectangle marked last */
+    if (paint->dirty_count > 0) {
+        const PaintRect* last = &paint->dirty[paint->dirty_count - 1];
+
+        if (x >= last->x && y >= last->y && right <= last->x + last->width && bottom <= last->y + last->height) {
+            return;
+        }
+    }
+    rect.x = x;
+    rect.y = y;
+    rect.width = right - x;
+    rect.height = bottom - y;
+
+    for (;;) {
+        int best = -1;
+        int best_waste = 0;
+
+        for (int i = 0; i < paint->dirty_count; i++) {
+            int waste = rect_merge_waste(&rect, &paint->dirty[i]);
+            if (best < 0 || waste < best_waste) {
+                best = i;
+                best_waste = waste;
+            }
+        }
+        if (best < 0 || (best_waste > PAINT_DIRTY_MERGE_WASTE && paint->dirty_count < PAINT_MAX_DIRTY_RECTS)) {
+            paint->dirty[paint->dirty_count++] = rect;
+            return;
+        }
+        /* merging may make the rectangle overlap others, so check again */
+        rect = rect_union(&rect, &paint->dirty[best]);
+        paint->dirty[best] = paint->dirty[--paint->dirty_count];
+    }
+}
+
+/**
+ *  @brief: the value of a frame buffer byte with all 8 pixels set to colored
+ */
+static inline unsigned char fill_value(int colored)
+{
+    if (IF_INVERT_COLOR) {
+        return colored ? 0xFF : 0x00;
+    } else {
+        return colored ? 0x00 : 0xFF;
+    }
+}
+
+// Frame buffer bytes with all 8 pixels set to an ink, one for each plane
+typedef struct {
+    unsigned char black;
+    unsigned char red;
+} InkBytes;
+
+/**
+ *  @brief: the bytes of an ink. it only colors the plane it is drawn
+ *          in and clears the other one, red is drawn in the black plane
+ *          of a canvas without red plane.
+ */
+static inline InkBytes ink_bytes(const Paint* paint, int ink)
+{
+    InkBytes bytes;
+
+    bytes.black = fill_value(ink == INK_BLACK || (ink == INK_RED && paint->image_red == NULL));
+    bytes.red = fill_value(ink == INK_RED);
+    return bytes;
+}
+
+/**
+ *  @brief: the first byte of row y of a plane, y by absolute coordinates
+ *          inside the band of the canvas
+ */
+static inline unsigned char* plane_row(const Paint* paint, unsigned char* plane, int y)
+{
+    return plane + (y - paint->top) * (paint->width / 8);
+}
+
+/**
+ *  @brief: fill count bytes with value, using 32-bit stores
+ *          once the destination is word aligned
+ */
+static inline void fill_bytes(unsigned char* dst, int count, unsigned char value)
+{
+    uint32_t word = value * 0x01010101u;
+    uint32_t* dst32;
+
+    while (count > 0 && ((uintptr_t)dst & 3) != 0) {
+        *dst++ = value;
+        count--;
+    }
+    dst32 = (uint32_t*)dst;
+    for (; count >= 16; count -= 16) {
+        dst32[0] = word;
+        dst32[1] = word;
+        dst32[2] = word;
+        dst32[3] = word;
+        dst32 += 4;
+    }
+    for (; count >= 4; count -= 4) {
+        *dst32++ = word;
+    }
+    dst = (unsigned char*)dst32;
+    while (count-- > 0) {
+        *dst++ = value;
+    }
+}
+
+/**
+ *  @brief: clear the image
+ */
+void clear(Paint* paint, int ink)
+{
+    InkBytes bytes = ink_bytes(paint, ink);
+
+    memset(paint->image, bytes.black, paint->width / 8 * paint->rows);
+    if (paint->image_red != NULL) {
+        memset(paint->image_red, bytes.red, paint->width / 8 * paint->rows);
+    }
+    paint_mark_dirty(paint, 0, paint->top, paint->width, paint->rows);
+}
+
+/**
+ *  @brief: fill the bytes first to last of a row, the edge bytes only
+ *          where their mask is set
+ */
+static inline void fill_masked_row(unsigned char* row, int first, int last, unsigned char first_mask, unsigned char last_mask, unsigned char value)
+{
+    if (first == last) {
+        first_mask &= last_mask;
+        row[first] = (row[first] & ~first_mask) | (value & first_mask);
+        return;
+    }
+    row[first] = (row[first] & ~first_mask) | (value & first_mask);
+    fill_bytes(row + first + 1, last - first - 1, value);
+    row[last] = (row[last] & ~last_mask) | (value & last_mask);
+}
+
+/**
+ *  @brief: fill a rectangle by absolute coordinates that is already
+ *          clipped to the frame buffer and marked dirty.
+ *          whole bytes are written at once, only the bytes on the
+ *          left and right edge are masked. the red plane is filled
+ *          in the same pass, row by row with the black one.
+ */
+static void fill_absolute_area(Paint* paint, int x, int y, int rect_width, int rect_height, InkBytes value)
+{
+    int stride = paint->width / 8;
+    unsigned char* row = plane_row(paint, paint->image, y);
+    unsigned char* red_row = paint->image_red != NULL ? plane_row(paint, paint->image_red, y) : NULL;
+
+    /* full rows are one contiguous run of bytes */
+    if (rect_width == paint->width) {
+        fill_bytes(row, stride * rect_height, value.black);
+        if (red_row != NULL) {
+            fill_bytes(red_row, stride * rect_height, value.red);
+        }
+        return;
+    }
+
+    int first = x / 8;
+    int last = (x + rect_width - 1) / 8;
+    unsigned char first_mask = 0xFF >> (x % 8);
+    unsigned char last_mask = 0xFF << (7 - (x + rect_width - 1) % 8);
+
+    if (first == last) {
+        first_mask &= last_mask;
+        for (int i = 0; i < rect_height; i++, row += stride) {
+            row[first] = (row[first] & ~first_mask) | (value.black & first_mask);
+            if (red_row != NULL) {
+                red_row[first] = (red_row[first] & ~first_mask) | (value.red & first_mask);
+                red_row += stride;
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < rect_height; i++, row += stride) {
+        fill_masked_row(row, first, last, first_mask, last_mask, value.black);
+        if (red_row != NULL) {
+            fill_masked_row(red_row, first, last, first_mask, last_mask, value.red);
+            red_row += stride;
+        }
+    }
+}
+
+/**
+ *  @brief: this fills a rectangle by absolute coordinates.
+ *          this function won't be affected by the rotation.
+ */
+void fill_absolute_rectangle(Paint* paint, int x, int y, int rect_width, int rect_height, int ink)
+{
+    if (x < 0) {
+        rect_width += x;
+        x = 0;
+    }
+    if (y < paint->top) {
+        rect_height -= paint->top - y;
+        y = paint->top;
+    }
+    if (x + rect_width > paint->width) {
+        rect_width = paint->width - x;
+    }
+    if (y + rect_height > paint->top + paint->rows) {
+        rect_height = paint->top + paint->rows - y;
+    }
+    if (rect_width <= 0 || rect_height <= 0) {
+        return;
+    }
+
+    paint_mark_dirty(paint, x, y, rect_width, rect_height);
+    fill_absolute_area(paint, x, y, rect_width, rect_height, ink_bytes(paint, ink));
+}
+
+/**
+ *  @brief: set or reset the bit of one pixel in one plane
+ */
+static inline void set_plane_bit(unsigned char* byte, unsigned char bit, int colored)
+{
+    if (IF_INVERT_COLOR ? colored : !colored) {
+        *byte |= bit;
+    } else {
+        *byte &= ~bit;
+    }
+}
+
+/**
+ *  @brief: set the bits of one pixel in both planes, the coordinates must
+ *          be inside the canvas. pixels outside its band are left out.
+ */
+static inline void set_absolute_pixel(Paint* paint, int x, int y, int ink)
+{
+    if ((unsigned int)(y - paint->top) >= (unsigned int)paint->rows) {
+        return;
+    }
+
+    int index = (x + (y - paint->top) * paint->width) / 8;
+    unsigned char bit = 0x80 >> (x % 8);
+
+    if (paint->image_red == NULL) {
+        set_plane_bit(&paint->image[index], bit, ink != INK_WHITE);
+        return;
+    }
+    set_plane_bit(&paint->image[index], bit, ink == INK_BLACK);
+    set_plane_bit(&paint->image_red[index], bit, ink == INK_RED);
+}
+
+/**
+ *  @brief: this draws a pixel by absolute coordinates.
+ *          this function won't be affected by the rotation.
+ */
+void draw_absolute_pixel(Paint* paint, int x, int y, int ink)
+{
+    if (x < 0 || x >= paint->width || y < 0 || y >= paint->height) {
+        return;
+    }
+    paint_mark_dirty(paint, x, y, 1, 1);
+    set_absolute_pixel(paint, x, y, ink);
+}
+
+/*
+ * Every orientation gets its own straight-line mapping from canvas to
+ * absolute coordinates, for single pixels and for rectangles. Only the
+ * one selected by PAINT_ROTATE is used, so drawing never checks the
+ * rotation at runtime.
+ */
+#define DEFINE_ROTATION(name, canvas_width, canvas_height, pixel_x, pixel_y, rect_x, rect_y, rect_w, rect_h) \
+    static inline void draw_pixel_##name(Paint* paint, int x, int y, int ink)                              \
+    {                                                                                                      \
+        if (x < 0 || x >= (canvas_width) || y < 0 || y >= (canvas_height)) {                              \
+            return;                                                                                        \
+        }                                                                                                  \
+        set_absolute_pixel(paint, (pixel_x), (pixel_y), ink);                                              \
+    }                                                                                                      \
+                                                                                                           \
+    static inline int map_rectangle_##name(Paint* paint, PaintRect* rect, int x, int y, int w, int h)      \
+    {                                                                                                      \
+        if (x < 0) {                                                                                       \
+            w += x;                                                                                        \
+            x = 0;                                                                                         \
+        }                                                                                                  \
+        if (y < 0) {                                                                                       \
+            h += y;                                                                                        \
+            y = 0;                                                                                         \
+        }                                                                                                  \
+        if (x + w > (canvas_width)) {                                                                      \
+            w = (canvas_width) - x;                                                                        \
+        }                                                                                                  \
+        if (y + h > (canvas_height)) {                                                                     \
+            h = (canvas_height) - y;                                                                       \
+        }                                                                                                  \
+        if (w <= 0 || h <= 0) {                                                                            \
+            return 0;                                                                                      \
+        }                                                                                                  \
+        rect->x = (rect_x);                                                                                \
+        rect->y = (rect_y);                                                                                \
+        rect->width = (rect_w);                                                                            \
+        rect->height = (rect_h);                                                                           \
+        return 1;                                                                                          \
+    }
+
+DEFINE_ROTATION(rotate_0, paint->width, paint->height,
+    x, y,
+    x, y, w, h)
+DEFINE_ROTATION(rotate_90, paint->height, paint->width,
+    paint->width - 1 - y, x,
+    paint->width - y - h, x, h, w)
+DEFINE_ROTATION(rotate_180, paint->width, paint->height,
+    paint->width - 1 - x, paint->height - 1 - y,
+    paint->width - x - w, paint->height - y - h, w, h)
+DEFINE_ROTATION(rotate_270, paint->height, paint->width,
+    y, paint->height - 1 - x,
+    y, paint->height - x - w, h, w)
+
+#if PAINT_ROTATE == ROTATE_0
+#define draw_rotated_pixel draw_pixel_rotate_0
+#define map_rotated_rectangle map_rectangle_rotate_0
+#elif PAINT_ROTATE == ROTATE_90
+#define draw_rotated_pixel draw_pixel_rotate_90
+#define map_rotated_rectangle map_rectangle_rotate_90
+#elif PAINT_ROTATE == ROTATE_180
+#define draw_rotated_pixel draw_pixel_rotate_180
+#define map_rotated_rectangle map_rectangle_rotate_180
+#elif PAINT_ROTATE == ROTATE_270
+#define draw_rotated_pixel draw_pixel_rotate_270
+#define map_rotated_rectangle map_rectangle_rotate_270
+#else
+#error "PAINT_ROTATE must be one of ROTATE_0, ROTATE_90, ROTATE_180 or ROTATE_270"
+#endif
+
+/**
+ *  @brief: record a rectangle by the coordinates as dirty
+ */
+static inline void mark_rotated_dirty(Paint* paint, int x, int y, int rect_width, int rect_height)
+{
+    PaintRect rect;
+
+    if (map_rotated_rectangle(paint, &rect, x, y, rect_width, rect_height)) {
+        paint_mark_dirty(paint, rect.x, rect.y, rect.width, rect.height);
+    }
+}
+
+/**
+ *  @brief: whether a rectangle by the coordinates misses the band of the
+ *          canvas, so a frame drawn band by band skips what is not in it
+ */
+static inline int outside_band(Paint* paint, int x, int y, int rect_width, int rect_height)
+{
+    PaintRect rect;
+
+    if (paint->rows == paint->height) {
+        return 0;
+    }
+    if (!map_rotated_rectangle(paint, &rect, x, y, rect_width, rect_height)) {
+        return 1;
+    }
+    return rect.y >= paint->top + paint->rows || rect.y + rect.height <= paint->top;
+}
+
+/**
+ *  @brief: this draws a pixel by the coordinates
+ */
+void draw_pixel(Paint* paint, int x, int y, int ink)
+{
+    mark_rotated_dirty(paint, x, y, 1, 1);
+    draw_rotated_pixel(paint, x, y, ink);
+}
+
+/**
+ *  @brief: this fills a rectangle by the coordinates.
+ *          the rectangle is clipped and mapped to the frame buffer once,
+ *          then filled as byte spans.
+ */
+void fill_rectangle(Paint* paint, int x, int y, int rect_width, int rect_height, int ink)
+{
+    PaintRect rect;
+
+    if (map_rotated_rectangle(paint, &rect, x, y, rect_width, rect_height)) {
+        fill_absolute_rectangle(paint, rect.x, rect.y, rect.width, rect.height, ink);
+    }
+}
+
+/**
+ *  @brief: index of code in the direct index of a font, -1 when the code
+ *          is not in one of its ranges
+ */
+static inline int find_range_index(int code, const tFontRange* ranges, int range_count)
+{
+    for (int i = 0; i < range_count; i++) {
+        if ((unsigned long)(code - ranges[i].first) < (unsigned long)ranges[i].count) {
+            return ranges[i].index + (code - ranges[i].first);
+        }
+    }
+    return -1;
+}
+
+/*
+ * Binary search by code over the tChar array of a tFont or the tGlyph
+ * array of a tPackedFont, both sorted by code.
+ */
+#define DEFINE_CODE_SEARCH(name, type)                                           \
+    static int name(const type* entries, int count, int code)                    \
+    {                                                                            \
+        int first = 0;                                                           \
+        int last = count - 1;                                                    \
+                                                                                 \
+        if (count == 0 || code < entries[0].code || code > entries[last].code) { \
+            return -1;                                                           \
+        }                                                                        \
+        while (last >= first) {                                                  \
+            int mid = first + ((last - first) / 2);                              \
+                                                                                 \
+            if (entries[mid].code < code)                                        \
+                first = mid + 1;                                                 \
+            else if (entries[mid].code > code)                                   \
+                last = mid - 1;                                                  \
+            else                                                                 \
+                return mid;                                                      \
+        }                                                                        \
+        return -1;                                                               \
+    }
+
+DEFINE_CODE_SEARCH(search_chars, tChar)
+DEFINE_CODE_SEARCH(search_glyphs, tGlyph)
+
+/**
+ *  @brief: index of the glyph for code in the chars of a tFont, or in the
+ *          glyphs of its packed font when it has one. -1 when the font
+ *          does not have it.
+ */
+static int find_glyph_index(int code, const tFont* font)
+{
+    const tPackedFont* packed = font->packed;
+    int index;
+
+    if (packed != NULL) {
+        index = find_range_index(code, packed->ranges, packed->range_count);
+        return index >= 0 ? index : search_glyphs(packed->glyphs, packed->length, code);
+    }
+    index = find_range_index(code, font->ranges, font->range_count);
+    return index >= 0 ? index : search_chars(font->chars, font->length, code);
+}
+
+/**
+ *  @brief: look a character up in the direct index of the font, and only
+ *          search chars when the code is not in one of its ranges.
+ *          packed fonts have no chars, use shape_glyph_run() for them.
+ */
+const tChar* find_char_by_code(int code, const tFont* font)
+{
+    int index = find_range_index(code, font->ranges, font->range_count);
+
+    if (index < 0) {
+        index = search_chars(font->chars, font->length, code);
+    }
+    return index >= 0 ? &font->chars[index] : 0;
+}
+
+int utf8_next_char(const char* str, int start, int* resultCode, int* nextIndex)
+{
+    int index = 0;
+
+    unsigned char c;
+    unsigned int code = 0;
+    int result = 0;
+    int skip = 0;
+
+    *resultCode = 0;
+    *nextIndex = -1;
+
+    if (start >= 0) {
+        index = start;
+
+        // the terminating zero ends the string, so it is never measured up front
+        while (*(str + index) != 0) {
+            c = *(str + index);
+            index++;
+
+            // msb
+            if (skip == 0) {
+                // if range 0x00010000-0x001fffff
+                if ((c & 0xf8) == 0xf0) {
+                    skip = 3;
+                    code = c;
+                }
+                // if range 0x00000800-0x0000ffff
+                else if ((c & 0xf0) == 0xe0) {
+                    skip = 2;
+                    code = c;
+                }
+                // if range 0x00000080-0x000007ff
+                else if ((c & 0xe0) == 0xc0) {
+                    skip = 1;
+                    code = c;
+                }
+                // if range 0x00-0x7f
+                else //if ((c & 0x80) == 0x00)
+                {
+                    skip = 0;
+                    code = c;
+                }
+            } else // not msb
+            {
+                code = code << 8;
+                code |= c;
+                skip--;
+            }
+            if (skip == 0) {
+                // completed
+                *resultCode = code;
+                *nextIndex = index;
+                result = 1;
+                break;
+            }
+        }
+    }
+    return (result);
+}
+
+// Whole pixels of a fixed point pen position, rounded to the nearest one
+#define PEN_PIXELS(pen) (((pen) + (1 << GLYPH_ADVANCE_SHIFT) / 2) >> GLYPH_ADVANCE_SHIFT)
+
+// Pen position while a string is shaped, in fixed point and whole pixels
+typedef struct {
+    int pen;
+    int x; // PEN_PIXELS(pen)
+    int glyph; // the glyph before the pen, -1 at the start
+} TextPen;
+
+static inline int glyph_advance(const tFont* font, int glyph)
+{
+    return font->packed != NULL ? font->packed->glyphs[glyph].advance : font->chars[glyph].image->width << GLYPH_ADVANCE_SHIFT;
+}
+
+/**
+ *  @brief: kerning of a pair of glyphs of a packed font. the pairs of a
+ *          glyph are few and most glyphs have none, so they are scanned.
+ */
+static int glyph_kerning(const tPackedFont* font, int left, int right)
+{
+    const tKernPair* pair = &font->kerning[font->glyphs[left].kerning];
+    const tKernPair* end = &font->kerning[left + 1 < font->length ? font->glyphs[left + 1].kerning : font->kerning_count];
+
+    for (; pair < end && pair->right <= right; pair++) {
+        if (pair->right == right) {
+            return pair->adjust;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  @brief: move the pen over a glyph, kerned against the glyph before it.
+ *          advances in whole pixels are the differences of the rounded pen
+ *          positions, so the fractions add up along a string.
+ *  @return: the advance of the glyph in pixels, *kerning is what the
+ *           advance of the glyph before it changes by
+ */
+static inline int pen_advance(TextPen* pen, const tFont* font, int glyph, int* kerning)
+{
+    int x = pen->x;
+
+    *kerning = 0;
+    if (pen->glyph >= 0 && font->packed != NULL && font->packed->kerning_count != 0) {
+        pen->pen += glyph_kerning(font->packed, pen->glyph, glyph);
+        pen->x = PEN_PIXELS(pen->pen);
+        *kerning = pen->x - x;
+        x = pen->x;
+    }
+    pen->pen += glyph_advance(font, glyph);
+    pen->x = PEN_PIXELS(pen->pen);
+    pen->glyph = glyph;
+    return pen->x - x;
+}
+
+/**
+ *  @brief: decode str once into the glyphs of font, until the end of the
+ *          string or until the run is full. characters the font does not
+ *          have are left out. a run starts on a whole pixel, kerning does
+ *          not reach over from the run before it.
+ *  @return: the rest of the string that did not fit in the run, an empty
+ *           string when all of it did
+ */
+const char* shape_glyph_run(GlyphRun* run, const char* str, const tFont* font)
+{
+    int index = 0;
+    int code = 0;
+    int nextIndex;
+    TextPen pen = { 0, 0, -1 };
+
+    run->font = font;
+    run->count = 0;
+    run->width = 0;
+
+    while (run->count < GLYPH_RUN_LENGTH) {
+        if (utf8_next_char(str, index, &code, &nextIndex) == 0) {
+            // end of the string, or a truncated sequence at its end
+            return str + index + strlen(str + index);
+        }
+        int glyph = find_glyph_index(code, font);
+        if (glyph >= 0) {
+            int kerning;
+            int advance = pen_advance(&pen, font, glyph, &kerning);
+
+            if (run->count > 0) {
+                run->advances[run->count - 1] += kerning;
+            }
+            run->glyphs[run->count] = glyph;
+            run->advances[run->count] = advance;
+            run->width += kerning + advance;
+            run->count++;
+        }
+        index = nextIndex;
+    }
+
+    return str + index;
+}
+
+static void blit_bitmap(Paint* paint, int x, int y, const uint8_t* data, uint32_t bit, int stride, int width, int height, int ink, int mark, int transparent);
+static void draw_image(Paint* paint, int x, int y, const tImage* bitmap, int ink, int mark);
+
+/**
+ *  @brief: draw glyphs without marking each of them dirty, the box of all
+ *          of them is marked once at the end
+ */
+static void draw_glyphs(Paint* paint, const tFont* font, const uint16_t* glyphs, const int* advances, int count, int x, int y, int ink)
+{
+    const tPackedFont* packed = font->packed;
+    int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+
+    for (int i = 0; i < count; i++) {
+        int left, top, width, height;
+
+        if (packed != NULL) {
+            const tGlyph* glyph = &packed->glyphs[glyphs[i]];
+
+            left = x + glyph->left;
+            top = y + glyph->top;
+            width = glyph->width;
+            height = glyph->height;
+            blit_bitmap(paint, left, top, packed->atlas, glyph->offset, width, width, height, ink, 0, 1);
+        } else {
+            const tImage* image = font->chars[glyphs[i]].image;
+
+            left = x + image->left;
+            top = y + image->top;
+            width = image->width;
+            height = image->height;
+            draw_image(paint, x, y, image, ink, 0);
+        }
+        if (width > 0 && height > 0) {
+            if (x1 == x0) {
+                x0 = left;
+                x1 = left + width;
+                y0 = top;
+                y1 = top + height;
+            } else {
+                x0 = left < x0 ? left : x0;
+                x1 = left + width > x1 ? left + width : x1;
+                y0 = top < y0 ? top : y0;
+                y1 = top + height > y1 ? top + height : y1;
+            }
+        }
+        x += advances[i];
+    }
+    if (x1 > x0) {
+        mark_rotated_dirty(paint, x0, y0, x1 - x0, y1 - y0);
+    }
+}
+
+void draw_glyph_run(Paint* paint, const GlyphRun* run, int x, int y, int ink)
+{
+    draw_glyphs(paint, run->font, run->glyphs, run->advances, run->count, x, y, ink);
+}
+
+// A string measured for drawing, from the text cache or shaped from its font
+typedef struct {
+    GlyphRun run;
+    const char* rest; // what did not fit in the run
+    uint32_t key; // of the string in the text cache, 0 without one
+    TextCacheEntry* cached; // NULL when the text cache does not have the string
+    int width;
+} MeasuredString;
+
+static uint32_t text_cache_key(TextCache* cache, const char* str, const tFont* font);
+static TextCacheEntry* find_cached_string(TextCache* cache, uint32_t key);
+static void draw_cached_string(Paint* paint, const TextCacheEntry* entry, int x, int y, int ink);
+static void remember_string(TextCache* cache, const MeasuredString* string);
+
+/**
+ *  @brief: measure a string from its entry in the text cache, or shape the
+ *          first run of str and measure the whole string. the rest is only
+ *          shaped again for strings longer than a run.
+ */
+static int measure_string(Paint* paint, MeasuredString* string, const char* str, const tFont* font)
+{
+    string->key = text_cache_key(paint->text_cache, str, font);
+    string->cached = string->key != 0 ? find_cached_string(paint->text_cache, string->key) : NULL;
+    if (string->cached != NULL && string->cached->size != 0) {
+        string->width = string->cached->width;
+        return string->width;
+    }
+
+    string->rest = shape_glyph_run(&string->run, str, font);
+    string->width = *string->rest != 0 ? string->run.width + calculate_width(string->rest, font) : string->run.width;
+    return string->width;
+}
+
+static void draw_glyph_runs(Paint* paint, const char* str, int x, int y, const tFont* font, int ink)
+{
+    GlyphRun run;
+
+    do {
+        str = shape_glyph_run(&run, str, font);
+        draw_glyph_run(paint, &run, x, y, ink);
+        x += run.width;
+    } while (*str != 0);
+}
+
+static void draw_measured_string(Paint* paint, const MeasuredString* string, int x, int y, const tFont* font, int ink)
+{
+    int height = font_line_height(font);
+
+    // glyphs may reach out of the advances of the string, not out of its line
+    if (outside_band(paint, x - height, y, string->width + 2 * height, height)) {
+        return;
+    }
+    if (string->cached != NULL && string->cached->size != 0) {
+        string->cached->wake = paint->text_cache->wake;
+        draw_cached_string(paint, string->cached, x, y, ink);
+        return;
+    }
+    draw_glyph_run(paint, &string->run, x, y, ink);
+    if (*string->rest != 0) {
+        draw_glyph_runs(paint, string->rest, x + string->run.width, y, font, ink);
+    } else if (string->key != 0) {
+        remember_string(paint->text_cache, string);
+    }
+}
+
+void draw_string(Paint* paint, const char* str, int x, int y, const tFont* font, int ink)
+{
+    MeasuredString string;
+
+    measure_string(paint, &string, str, font);
+    draw_measured_string(paint, &string, x, y, font, ink);
+}
+
+void draw_bitmap_mono_in_center(Paint* paint, int x_dev, int x_number, int width, int y, const tImage* bitmap, int ink)
+{
+    int bitmap_width = bitmap->full_width != 0 ? bitmap->full_width : bitmap->width;
+
+    draw_bitmap_mono(paint, ((width / x_dev)) * (x_number) + (((width / x_dev) - bitmap_width) / 2), y, bitmap, ink);
+}
+
+void draw_string_in_grid_align_center(Paint* paint, int x_dev, int x_number, int width, int y, const char* str, const tFont* font, int ink)
+{
+    MeasuredString string;
+    int str_width_on_display = measure_string(paint, &string, str, font);
+    draw_measured_string(paint, &string, ((width / x_dev)) * (x_number) + (((width / x_dev) - str_width_on_display) / 2), y, font, ink);
+}
+
+void draw_string_in_grid_align_left(Paint* paint, int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font, int ink)
+{
+    MeasuredString string;
+    int str_width_on_display = measure_string(paint, &string, str, font);
+    draw_measured_string(paint, &string, ((width / x_dev)) * (x_number) + (((width / x_dev) - str_width_on_display) - offset), y, font, ink);
+}
+
+void draw_string_in_grid_align_right(Paint* paint, int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font, int ink)
+{
+    draw_string(paint, str, ((width / x_dev)) * (x_number) + offset, y, font, ink);
+}
+
+int calculate_width(const char* str, const tFont* font)
+{
+    GlyphRun run;
+    int width = 0;
+
+    do {
+        str = shape_glyph_run(&run, str, font);
+        width += run.width;
+    } while (*str != 0);
+
+    return width;
+}
+
+int font_line_height(const tFont* font)
+{
+    if (font->packed != NULL) {
+        return font->packed->height;
+    }
+    return font->length > 0 ? font->chars[0].image->height : 0;
+}
+
+/**
+ *  @brief: end the last line of a paragraph that was cut off with an
+ *          ellipsis, U+2026 or "..." when the font does not have it.
+ *          glyphs are taken off its end until the ellipsis fits in width.
+ */
+static void add_ellipsis(TextLayout* layout, int width)
+{
+    TextLine* line = &layout->lines[layout->line_count - 1];
+    int space = find_glyph_index(' ', layout->font);
+    int glyph = find_glyph_index(0xE280A6, layout->font); // U+2026 as UTF-8 code
+    int count = 1;
+    int advance;
+    int ellipsis_width;
+
+    if (glyph < 0) {
+        glyph = find_glyph_index('.', layout->font);
+        count = 3;
+    }
+    if (glyph < 0) {
+        return;
+    }
+    advance = glyph_advance(layout->font, glyph);
+    ellipsis_width = PEN_PIXELS(count * advance);
+
+    while (line->count > 0
+        && (line->width + ellipsis_width > width
+            || line->first + line->count + count > TEXT_LAYOUT_GLYPHS
+            || layout->glyphs[line->first + line->count - 1] == space)) {
+        line->count--;
+        line->width -= layout->advances[line->first + line->count];
+    }
+    if (line->first + line->count + count > TEXT_LAYOUT_GLYPHS) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        layout->glyphs[line->first + line->count] = glyph;
+        layout->advances[line->first + line->count] = PEN_PIXELS((i + 1) * advance) - PEN_PIXELS(i * advance);
+        line->count++;
+    }
+    line->width += ellipsis_width;
+}
+
+static int add_line(TextLayout* layout, int first, int end, int width, int max_lines)
+{
+    if (layout->line_count == max_lines) {
+        return 0;
+    }
+    layout->lines[layout->line_count].first = first;
+    layout->lines[layout->line_count].count = end - first;
+    layout->lines[layout->line_count].width = width;
+    layout->line_count++;
+    return 1;
+}
+
+/**
+ *  @brief: decode str once into the glyphs of font and break it into lines
+ *          of at most width pixels, at spaces or inside words longer than a
+ *          line. the widths come from the same pass over the advances. text
+ *          that does not fit in max_lines lines or TEXT_LAYOUT_GLYPHS glyphs
+ *          is cut off with an ellipsis at the end of the last line.
+ *  @return: the number of lines
+ */
+int layout_paragraph(TextLayout* layout, const char* str, const tFont* font, int width, int max_lines)
+{
+    int index = 0;
+    int code;
+    int next;
+    int count = 0;
+    int cut = 0;
+    int line_first = 0, line_width = 0;
+    // end of the line when it breaks at the last space, and its width
+    int break_end = 0, break_width = 0;
+    // first glyph of the word after that space, and the width before it
+    int word_first = 0, word_left = 0;
+    // end of the last word, for the last line
+    int content_end = 0, content_width = 0;
+    int after_space = 0;
+    TextPen pen = { 0, 0, -1 };
+
+    layout->font = font;
+    layout->line_count = 0;
+    max_lines = max_lines < TEXT_LAYOUT_LINES ? max_lines : TEXT_LAYOUT_LINES;
+    if (max_lines < 1) {
+        return 0;
+    }
+
+    while (utf8_next_char(str, index, &code, &next)) {
+        int glyph = find_glyph_index(code, font);
+        int advance;
+        int kerning;
+
+        index = next;
+        if (glyph < 0) {
+            continue;
+        }
+        // the kerning against the glyph before is only added once it is
+        // clear that both end up on the same line
+        advance = pen_advance(&pen, font, glyph, &kerning);
+        if (count == line_first) {
+            kerning = 0;
+        }
+        if (code == ' ') {
+            // spaces at the start of a line are left out
+            if (count > line_first && !after_space) {
+                break_end = count;
+                break_width = line_width;
+                after_space = 1;
+            }
+            if (count == line_first) {
+                continue;
+            }
+        } else {
+            if (after_space) {
+                word_first = count;
+                word_left = line_width + kerning;
+                after_space = 0;
+            }
+            // the rest of a word moved to the next line may not fit either
+            while (line_width + kerning + advance > width && count > line_first) {
+                if (break_end > line_first) {
+                    cut = !add_line(layout, line_first, break_end, break_width, max_lines);
+                    line_first = word_first;
+                    line_width -= word_left;
+                    content_width -= word_left;
+                } else {
+                    cut = !add_line(layout, line_first, count, line_width, max_lines);
+                    line_first = count;
+                    line_width = 0;
+                    kerning = 0;
+                }
+                if (cut) {
+                    break;
+                }
+                break_end = line_first;
+            }
+        }
+        if (cut || count == TEXT_LAYOUT_GLYPHS) {
+            cut = 1;
+            break;
+        }
+        if (kerning != 0) {
+            layout->advances[count - 1] += kerning;
+            line_width += kerning;
+            if (content_end == count && code != ' ') {
+                content_width += kerning;
+            }
+        }
+        layout->glyphs[count] = glyph;
+        layout->advances[count] = advance;
+        line_width += advance;
+        count++;
+        if (code != ' ') {
+            content_end = count;
+            content_width = line_width;
+        }
+    }
+
+    if (content_end > line_first && !add_line(layout, line_first, content_end, content_width, max_lines)) {
+        cut = 1;
+    }
+    if (cut && layout->line_count > 0) {
+        add_ellipsis(layout, width);
+    }
+    return layout->line_count;
+}
+
+/**
+ *  @brief: draw the lines of a paragraph below each other, from the line
+ *          whose top is y, aligned in the width pixels from x
+ */
+void draw_paragraph(Paint* paint, const TextLayout* layout, int x, int y, int width, int align, int ink)
+{
+    int line_height = font_line_height(layout->font);
+
+    for (int i = 0; i < layout->line_count; i++) {
+        const TextLine* line = &layout->lines[i];
+        int line_x = x;
+
+        if (align == TEXT_ALIGN_CENTER) {
+            line_x += (width - line->width) / 2;
+        } else if (align == TEXT_ALIGN_RIGHT) {
+            line_x += width - line->width;
+        }
+        draw_glyphs(paint, layout->font, &layout->glyphs[line->first], &layout->advances[line->first], line->count, line_x, y, ink);
+        y += line_height;
+    }
+}
+
+/**
+ *  @brief: this draws a bitmap pixel by pixel, used for bitmaps that are
+ *          not stored as 8 bit data blocks
+ */
+static void draw_bitmap_mono_pixels(Paint* paint, int x, int y, const tImage* bitmap, int ink)
+{
+    uint8_t value = 0;
+    int x0, y0;
+    int counter = 0;
+    const uint8_t* pdata = (const uint8_t*)bitmap->data;
+
+    // rows
+    for (y0 = 0; y0 < bitmap->height; y0++) {
+        // columns
+        counter = 0;
+        for (x0 = 0; x0 < bitmap->width; x0++) {
+            // load new data
+            if (counter == 0) {
+                value = *pdata++;
+                counter = bitmap->dataSize;
+            }
+            counter--;
+
+            // set pixel
+            if ((value & 0x80) != 0)
+                draw_rotated_pixel(paint, x + x0, y + y0, INK_WHITE);
+            else
+                draw_rotated_pixel(paint, x + x0, y + y0, ink);
+
+            value = value << 1;
+        }
+    }
+}
+
+/**
+ *  @brief: bitmap bits are set for uncolored pixels, convert 8 of them
+ *          to the frame buffer representation
+ */
+static inline unsigned char bitmap_value(unsigned char value)
+{
+    return IF_INVERT_COLOR ? ~value : value;
+}
+
+static inline void blit_byte(unsigned char* dst, unsigned char value, unsigned char mask)
+{
+    *dst = (*dst & ~mask) | (value & mask);
+}
+
+/**
+ *  @brief: copy count pixels starting at bit src_x of a bitmap row to
+ *          the frame buffer row dst, starting at pixel dst_x.
+ *          the source is shifted to the destination bit offset and
+ *          written a byte at a time, only the edge bytes are masked.
+ */
+static void blit_row(unsigned char* dst, int dst_x, const uint8_t* src, int src_x, int count)
+{
+    int first = dst_x / 8;
+    int last = (dst_x + count - 1) / 8;
+    unsigned char first_mask = 0xFF >> (dst_x % 8);
+    unsigned char last_mask = 0xFF << (7 - (dst_x + count - 1) % 8);
+    /* source bit lining up with the first pixel of dst[first], -7 or more */
+    int bit = src_x - dst_x % 8;
+    int shift = bit & 7;
+
+    if (first == last) {
+        first_mask &= last_mask;
+    }
+
+    if (shift == 0) {
+        /* source and destination share the same bit offset */
+        src += bit / 8;
+        blit_byte(dst + first, bitmap_value(src[0]), first_mask);
+        if (first == last) {
+            return;
+        }
+        if (IF_INVERT_COLOR) {
+            for (int i = 1; i < last - first; i++) {
+                dst[first + i] = bitmap_value(src[i]);
+            }
+        } else {
+            memcpy(dst + first + 1, src + 1, last - first - 1);
+        }
+        blit_byte(dst + last, bitmap_value(src[last - first]), last_mask);
+        return;
+    }
 
-void paint(unsigned char* image1, int width, int height)
+    int index = (bit + 8) / 8 - 1;
+    int src_last = (src_x + count - 1) / 8;
+    unsigned int hi = index >= 0 ? src[index] : 0;
+    unsigned int lo;
+
+    index++;
+    lo = index <= src_last ? src[index] : 0;
+    blit_byte(dst + first, bitmap_value((hi << shift) | (lo >> (8 - shift))), first_mask);
+    if (first == last) {
+        return;
+    }
+    for (int d = first + 1; d < last; d++) {
+        hi = lo;
+        lo = src[++index];
+        dst[d] = bitmap_value((hi << shift) | (lo >> (8 - shift)));
+    }
+    hi = lo;
+    index++;
+    lo = index <= src_last ? src[index] : 0;
+    blit_byte(dst + last, bitmap_value((hi << shift) | (lo >> (8 - shift))), last_mask);
+}
+
+/**
+ *  @brief: 8 bitmap bits starting at bit of src, which may be up to 7 bits
+ *          before it. bits outside the bytes up to src_last read as 0.
+ */
+static inline unsigned char source_byte(const uint8_t* src, int bit, int src_last)
 {
-    rotate = ROTATE_0;
-    image = image1;
-    /* 1 byte = 8 pixels, so the width should be the multiple of 8 */
-    width = width % 8 ? width + 8 - (width % 8) : width;
-    height = height;
+    int index = bit >> 3;
+    int shift = bit & 7;
+    unsigned int hi = index >= 0 ? src[index] : 0;
+    unsigned int lo = shift != 0 && index < src_last ? src[index + 1] : 0;
+
+    return (hi << shift) | (lo >> (8 - shift));
 }
 
 /**
- *  @brief: clear the image
+ *  @brief: draw the colored pixels of count bitmap pixels starting at bit
+ *          src_x of a bitmap row into the frame buffer rows black and red
+ *          (NULL without a red plane), starting at pixel dst_x. uncolored
+ *          pixels are left as they are, so glyphs whose boxes overlap keep
+ *          each other's ink.
  */
-void clear(int colored)
+static void blit_row_inked(unsigned char* black, unsigned char* red, int dst_x, const uint8_t* src, int src_x, int count, InkBytes value)
 {
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            draw_absolute_pixel(x, y, colored);
+    int first = dst_x / 8;
+    int last = (dst_x + count - 1) / 8;
+    int bit = src_x - dst_x % 8;
+    int src_last = (src_x + count - 1) / 8;
+
+    for (int d = first; d <= last; d++, bit += 8) {
+        unsigned char mask = ~source_byte(src, bit, src_last);
+
+        if (d == first) {
+            mask &= 0xFF >> (dst_x % 8);
+        }
+        if (d == last) {
+            mask &= 0xFF << (7 - (dst_x + count - 1) % 8);
+        }
+        if (mask == 0) {
+            continue;
+        }
+        black[d] = (black[d] & ~mask) | (value.black & mask);
+        if (red != NULL) {
+            red[d] = (red[d] & ~mask) | (value.red & mask);
         }
     }
 }
 
 /**
- *  @brief: this draws a pixel by absolute coordinates.
- *          this function won't be affected by the rotate parameter.
+ *  @brief: reads the 4 bit codes of an IMAGE_RLE bitmap, high nibble first
+ */
+typedef struct {
+    const uint8_t* data;
+    int high;
+} NibbleReader;
+
+static inline int read_nibble(NibbleReader* reader)
+{
+    if (reader->high) {
+        reader->high = 0;
+        return *reader->data >> 4;
+    }
+    reader->high = 1;
+    return *reader->data++ & 0x0F;
+}
+
+/**
+ *  @brief: code 1 to 15 is a run of that many pixels, code 0 is followed by
+ *          the length in 3 bit groups, least significant first, with bit 3
+ *          set on all groups but the last
+ */
+static inline int read_run(NibbleReader* reader)
+{
+    int code = read_nibble(reader);
+    int run = 0;
+    int shift = 0;
+
+    if (code != 0) {
+        return code;
+    }
+    do {
+        code = read_nibble(reader);
+        run |= (code & 0x07) << shift;
+        shift += 3;
+    } while (code & 0x08);
+
+    return run;
+}
+
+/**
+ *  @brief: fill count pixels of one frame buffer row starting at x,
+ *          for the short spans of compressed bitmaps
  */
-void draw_absolute_pixel(int x, int y, int colored)
+static inline void fill_row_span(unsigned char* row, int x, int count, unsigned char value)
 {
-    if (x < 0 || x >= width || y < 0 || y >= height) {
+    int first = x / 8;
+    int last = (x + count - 1) / 8;
+    unsigned char first_mask = 0xFF >> (x % 8);
+    unsigned char last_mask = 0xFF << (7 - (x + count - 1) % 8);
+
+    if (first == last) {
+        first_mask &= last_mask;
+        row[first] = (row[first] & ~first_mask) | (value & first_mask);
         return;
     }
-    if (IF_INVERT_COLOR) {
-        if (colored) {
-            image[(x + y * width) / 8] |= 0x80 >> (x % 8);
-        } else {
-            image[(x + y * width) / 8] &= ~(0x80 >> (x % 8));
-        }
-    } else {
-        if (colored) {
-            image[(x + y * width) / 8] &= ~(0x80 >> (x % 8));
-        } else {
-            image[(x + y * width) / 8] |= 0x80 >> (x % 8);
-        }
+    row[first] = (row[first] & ~first_mask) | (value & first_mask);
+    for (int i = first + 1; i < last; i++) {
+        row[i] = value;
     }
+    row[last] = (row[last] & ~last_mask) | (value & last_mask);
 }
 
 /**
- *  @brief: this draws a pixel by the coordinates
+ *  @brief: clip a rectangle by absolute coordinates to the band of the
+ *          canvas
+ *  @return: 0 when nothing of it is left
  */
-void draw_pixel(int x, int y, int colored)
+static inline int clip_to_band(const Paint* paint, PaintRect* rect)
 {
-    int point_temp;
-    if (rotate == ROTATE_0) {
-        if (x < 0 || x >= width || y < 0 || y >= height) {
-            return;
-        }
-        draw_absolute_pixel(x, y, colored);
-    } else if (rotate == ROTATE_90) {
-        if (x < 0 || x >= height || y < 0 || y >= width) {
-            return;
-        }
-        point_temp = x;
-        x = width - y;
-        y = point_temp;
-        draw_absolute_pixel(x, y, colored);
-    } else if (rotate == ROTATE_180) {
-        if (x < 0 || x >= width || y < 0 || y >= height) {
-            return;
-        }
-        x = width - x;
-        y = height - y;
-        draw_absolute_pixel(x, y, colored);
-    } else if (rotate == ROTATE_270) {
-        if (x < 0 || x >= height || y < 0 || y >= width) {
-            return;
+    int bottom = rect->y + rect->height;
+
+    if (rect->y < paint->top) {
+        rect->y = paint->top;
+    }
+    if (bottom > paint->top + paint->rows) {
+        bottom = paint->top + paint->rows;
+    }
+    rect->height = bottom - rect->y;
+    return rect->height > 0;
+}
+
+/**
+ *  @brief: this draws an IMAGE_RLE bitmap. the runs alternate between
+ *          uncolored and colored pixels, starting with uncolored, and are
+ *          written straight into both planes of the frame buffer, a row
+ *          at a time. an unrotated canvas stops decoding below its band.
+ */
+static void draw_bitmap_rle(Paint* paint, int x, int y, const tImage* bitmap, int ink, int mark)
+{
+    NibbleReader reader = { bitmap->data, 1 };
+    InkBytes values[2] = { ink_bytes(paint, INK_WHITE), ink_bytes(paint, ink) };
+    int inked = 0;
+    int col = 0;
+    int row = 0;
+    PaintRect rect;
+
+    if (bitmap->width == 0) {
+        return;
+    }
+    if (mark) {
+        mark_rotated_dirty(paint, x, y, bitmap->width, bitmap->height);
+    }
+
+    while (row < bitmap->height && (PAINT_ROTATE != ROTATE_0 || y + row < paint->top + paint->rows)) {
+        int run = read_run(&reader);
+
+        while (run > 0) {
+            int count = bitmap->width - col < run ? bitmap->width - col : run;
+
+            if (map_rotated_rectangle(paint, &rect, x + col, y + row, count, 1) && clip_to_band(paint, &rect)) {
+                if (rect.height == 1) {
+                    fill_row_span(plane_row(paint, paint->image, rect.y), rect.x, rect.width, values[inked].black);
+                    if (paint->image_red != NULL) {
+                        fill_row_span(plane_row(paint, paint->image_red, rect.y), rect.x, rect.width, values[inked].red);
+                    }
+                } else {
+                    fill_absolute_area(paint, rect.x, rect.y, rect.width, rect.height, values[inked]);
+                }
+            }
+            run -= count;
+            col += count;
+            if (col == bitmap->width) {
+                col = 0;
+                row++;
+            }
         }
-        point_temp = x;
-        x = y;
-        y = height - point_temp;
-        draw_absolute_pixel(x, y, colored);
+        inked = !inked;
     }
 }
 
-const tChar* find_char_by_code(int code, const tFont* font)
+/**
+ *  @brief: copy the rows of a bitmap that is clipped to the band of the
+ *          canvas into the plane of the ink with whole byte operations,
+ *          while the same span of the other plane is cleared. x, y and the
+ *          size are by absolute coordinates, the rows of the bitmap start
+ *          at bit src of data and are stride bits apart. a transparent
+ *          bitmap, like a glyph, only draws its colored pixels.
+ */
+static void blit_area(Paint* paint, int x, int y, int width, int height, const uint8_t* data, uint32_t src, int stride, int ink, int transparent)
 {
-    int count = font->length;
-    int first = 0;
-    int last = count - 1;
-    int mid = 0;
-
-    if (count > 0) {
-        if ((code >= font->chars[0].code) && (code <= font->chars[count - 1].code)) {
-            while (last >= first) {
-                mid = first + ((last - first) / 2);
-
-                if (font->chars[mid].code < code)
-                    first = mid + 1;
-                else if (font->chars[mid].code > code)
-                    last = mid - 1;
-                else
-                    break;
+    if (transparent) {
+        InkBytes value = ink_bytes(paint, ink);
+        unsigned char* black = plane_row(paint, paint->image, y);
+        unsigned char* red = paint->image_red != NULL ? plane_row(paint, paint->image_red, y) : NULL;
+
+        for (int i = 0; i < height; i++) {
+            blit_row_inked(black, red, x, data + src / 8, src % 8, width, value);
+            src += stride;
+            black += paint->width / 8;
+            if (red != NULL) {
+                red += paint->width / 8;
             }
+        }
+        return;
+    }
+
+    /* the bitmap leaves no ink of a white one */
+    if (ink == INK_WHITE) {
+        fill_absolute_area(paint, x, y, width, height, ink_bytes(paint, INK_WHITE));
+        return;
+    }
+
+    unsigned char* dst = plane_row(paint, paint->image, y);
+    unsigned char* paper = NULL;
 
-            if (font->chars[mid].code == code)
-                return (&font->chars[mid]);
+    if (paint->image_red != NULL) {
+        paper = plane_row(paint, paint->image_red, y);
+        if (ink == INK_RED) {
+            unsigned char* red = paper;
+            paper = dst;
+            dst = red;
+        }
+    }
+    if (paper == NULL) {
+        for (int i = 0; i < height; i++) {
+            blit_row(dst, x, data + src / 8, src % 8, width);
+            src += stride;
+            dst += paint->width / 8;
         }
+        return;
     }
 
-    return (0);
+    int first = x / 8;
+    int last = (x + width - 1) / 8;
+    unsigned char first_mask = 0xFF >> (x % 8);
+    unsigned char last_mask = 0xFF << (7 - (x + width - 1) % 8);
+
+    for (int i = 0; i < height; i++) {
+        blit_row(dst, x, data + src / 8, src % 8, width);
+        fill_masked_row(paper, first, last, first_mask, last_mask, fill_value(0));
+        src += stride;
+        dst += paint->width / 8;
+        paper += paint->width / 8;
+    }
 }
 
-int utf8_next_char(const char* str, int start, int* resultCode, int* nextIndex)
+// Pixels of a frame buffer row gathered from a bitmap at a time
+#define BLIT_ROW_PIXELS 256
+
+/**
+ *  @brief: gather count pixels of a bitmap into row, MSB first, starting
+ *          at bit src of data and step bits apart
+ */
+static void gather_bits(uint8_t* row, const uint8_t* data, int32_t src, int step, int count)
 {
-    int len = 0;
-    int index = 0;
-    *resultCode = 0;
+    uint8_t value = 0;
+    int i;
 
-    while (*(str + index) != 0) {
-        len++;
-        index++;
+    for (i = 0; i < count; i++, src += step) {
+        value = (value << 1) | ((data[src >> 3] >> (7 - (src & 7))) & 1);
+        if ((i & 7) == 7) {
+            row[i >> 3] = value;
+        }
     }
+    if (i & 7) {
+        row[i >> 3] = value << (8 - (i & 7));
+    }
+}
 
-    unsigned char c;
-    unsigned int code = 0;
-    int result = 0;
-    int skip = 0;
+/**
+ *  @brief: this draws a width x height bitmap on a rotated canvas. the
+ *          bitmap is clipped and mapped to the frame buffer once, every
+ *          frame buffer row it covers is a column (90 and 270 degrees) or a
+ *          reversed row (180 degrees) of the bitmap, gathered into a row
+ *          buffer and copied like an unrotated bitmap.
+ */
+static void blit_rotated_bitmap(Paint* paint, int x, int y, const uint8_t* data, uint32_t bit, int stride, int width, int height, int ink, int mark, int transparent)
+{
+    uint8_t row[BLIT_ROW_PIXELS / 8];
+    PaintRect rect;
+    int32_t src;
+    int step;
+    int next_row;
 
-    *resultCode = 0;
-    *nextIndex = -1;
+    if (!map_rotated_rectangle(paint, &rect, x, y, width, height) || !clip_to_band(paint, &rect)) {
+        return;
+    }
+    if (mark) {
+        paint_mark_dirty(paint, rect.x, rect.y, rect.width, rect.height);
+    }
+    if (ink == INK_WHITE && !transparent) {
+        blit_area(paint, rect.x, rect.y, rect.width, rect.height, NULL, 0, 0, ink, 0);
+        return;
+    }
 
-    if (start >= 0 && start < len) {
-        index = start;
+    /* the bitmap pixel at the top left of rect, the step to the next pixel
+       of a frame buffer row and to the next row */
+#if PAINT_ROTATE == ROTATE_90
+    // bitmap columns run down the frame buffer, its rows from right to left
+    src = bit + (paint->width - 1 - rect.x - y) * stride + rect.y - x;
+    step = -stride;
+    next_row = 1;
+#elif PAINT_ROTATE == ROTATE_180
+    // bitmap rows run from right to left, from the bottom up
+    src = bit + (paint->height - 1 - rect.y - y) * stride + paint->width - 1 - rect.x - x;
+    step = -1;
+    next_row = -stride;
+#else
+    // bitmap columns run up the frame buffer, its rows from left to right
+    src = bit + (rect.x - y) * stride + paint->height - 1 - rect.y - x;
+    step = stride;
+    next_row = -1;
+#endif
 
-        while (index < len) {
-            c = *(str + index);
-            index++;
+    for (int i = 0; i < rect.height; i++, src += next_row) {
+        for (int done = 0; done < rect.width; done += BLIT_ROW_PIXELS) {
+            int count = rect.width - done < BLIT_ROW_PIXELS ? rect.width - done : BLIT_ROW_PIXELS;
 
-            // msb
-            if (skip == 0) {
-                // if range 0x00010000-0x001fffff
-                if ((c & 0xf8) == 0xf0) {
-                    skip = 3;
-                    code = c;
-                }
-                // if range 0x00000800-0x0000ffff
-                else if ((c & 0xf0) == 0xe0) {
-                    skip = 2;
-                    code = c;
-                }
-                // if range 0x00000080-0x000007ff
-                else if ((c & 0xe0) == 0xc0) {
-                    skip = 1;
-                    code = c;
-                }
-                // if range 0x00-0x7f
-                else //if ((c & 0x80) == 0x00)
-                {
-                    skip = 0;
-                    code = c;
-                }
-            } else // not msb
-            {
-                code = code << 8;
-                code |= c;
-                skip--;
-            }
-            if (skip == 0) {
-                // completed
-                *resultCode = code;
-                *nextIndex = index;
-                result = 1;
-                break;
-            }
+            gather_bits(row, data, src + done * step, step, count);
+            blit_area(paint, rect.x + done, rect.y + i, count, 1, row, 0, 0, ink, transparent);
         }
     }
-    return (result);
 }
 
-void draw_string(const char* str, int x, int y, const tFont* font)
+/**
+ *  @brief: this draws a width x height bitmap with 1 bit per pixel whose
+ *          rows are stride bits apart, starting at bit of data. it is
+ *          clipped once and copied row by row with whole byte operations,
+ *          see blit_area(). the box is marked dirty if mark is set.
+ */
+static void blit_bitmap(Paint* paint, int x, int y, const uint8_t* data, uint32_t bit, int stride, int width, int height, int ink, int mark, int transparent)
 {
-    int len = strlen(str);
-    int index = 0;
-    int code = 0;
-    int x1 = x;
-    int nextIndex;
-    while (index < len) {
-        if (utf8_next_char(str, index, &code, &nextIndex) != 0) {
-            const tChar* ch = find_char_by_code(code, font);
-            if (ch != 0) {
-                draw_bitmap_mono(x1, y, ch->image);
-                x1 += ch->image->width;
-            }
+    if (PAINT_ROTATE != ROTATE_0) {
+        blit_rotated_bitmap(paint, x, y, data, bit, stride, width, height, ink, mark, transparent);
+        return;
+    }
+
+    int src_x = 0;
+    int src_y = 0;
+
+    if (x < 0) {
+        src_x = -x;
+        width += x;
+        x = 0;
+    }
+    if (y < paint->top) {
+        src_y = paint->top - y;
+        height -= src_y;
+        y = paint->top;
+    }
+    if (x + width > paint->width) {
+        width = paint->width - x;
+    }
+    if (y + height > paint->top + paint->rows) {
+        height = paint->top + paint->rows - y;
+    }
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (mark) {
+        paint_mark_dirty(paint, x, y, width, height);
+    }
+    blit_area(paint, x, y, width, height, data, bit + src_y * stride + src_x, stride, ink, transparent);
+}
+
+/**
+ *  @brief: this draws a monochrome bitmap, trimmed bitmaps only their box
+ *          of ink at its place in the full bitmap. the box is marked dirty
+ *          if mark is set.
+ */
+static void draw_image(Paint* paint, int x, int y, const tImage* bitmap, int ink, int mark)
+{
+    x += bitmap->left;
+    y += bitmap->top;
+    if (outside_band(paint, x, y, bitmap->width, bitmap->height)) {
+        return;
+    }
+    if (bitmap->compression == IMAGE_RLE) {
+        draw_bitmap_rle(paint, x, y, bitmap, ink, mark);
+        return;
+    }
+    if (bitmap->dataSize != 8) {
+        if (mark) {
+            mark_rotated_dirty(paint, x, y, bitmap->width, bitmap->height);
         }
-        index = nextIndex;
-        if (nextIndex < 0)
-            break;
+        draw_bitmap_mono_pixels(paint, x, y, bitmap, ink);
+        return;
     }
+    blit_bitmap(paint, x, y, bitmap->data, 0, (bitmap->width + 7) / 8 * 8, bitmap->width, bitmap->height, ink, mark, 0);
 }
 
-void draw_bitmap_mono_in_center(int x_dev, int x_number, int width, int y, const tImage* image)
+void draw_bitmap_mono(Paint* paint, int x, int y, const tImage* bitmap, int ink)
 {
-    draw_bitmap_mono(((width / x_dev)) * (x_number) + (((width / x_dev) - image->width) / 2), y, image);
+    draw_image(paint, x, y, bitmap, ink, 1);
 }
 
-void draw_string_in_grid_align_center(int x_dev, int x_number, int width, int y, const char* str, const tFont* font)
+/**
+ *  @brief: this draws a glyph of a packed font with the pen at x, on the
+ *          line whose top is y. only the bounding box of its ink is drawn.
+ */
+void draw_packed_glyph(Paint* paint, int x, int y, const tPackedFont* font, const tGlyph* glyph, int ink)
 {
-    int str_width_on_display = calculate_width(str, font);
-    draw_string(str, ((width / x_dev)) * (x_number) + (((width / x_dev) - str_width_on_display) / 2), y, font);
+    blit_bitmap(paint, x + glyph->left, y + glyph->top, font->atlas, glyph->offset, glyph->width, glyph->width, glyph->height, ink, 1, 1);
 }
 
-void draw_string_in_grid_align_left(int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font)
+/*
+ * Text cache: a string drawn with a packed font is remembered by the hash
+ * of its bytes and of the font. When it is drawn in a later
+ * wake as well its glyphs are rendered once into a bitmap of their bounding
+ * box, and from then on the string is blitted from there without decoding,
+ * measuring or drawing its glyphs. That bitmap includes the pixels between
+ * the glyphs, so cached strings should be drawn over an uncolored area.
+ * Entries that were not drawn in the current wake make room for new ones.
+ */
+
+static uint32_t hash_bytes(uint32_t hash, const void* data, size_t size)
 {
-    int str_width_on_display = calculate_width(str, font);
-    draw_string(str, ((width / x_dev)) * (x_number) + (((width / x_dev) - str_width_on_display) - offset), y, font);
+    const uint8_t* bytes = data;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
 }
 
-void draw_string_in_grid_align_right(int x_dev, int x_number, int offset, int width, int y, const char* str, const tFont* font)
+/**
+ *  @brief: start a wake. the strings that were not drawn in the wake
+ *          before are dropped, the bitmaps of the others move down and stay
+ *          in the order of the entries. nothing is dropped while a frame
+ *          is drawn, so the strings it is about to draw keep their room.
+ */
+void text_cache_begin(TextCache* cache)
 {
-    draw_string(str, ((width / x_dev)) * (x_number) + offset, y, font);
+    int count = 0;
+    int used = 0;
+
+    for (int i = 0; i < cache->count; i++) {
+        TextCacheEntry entry = cache->entries[i];
+
+        if (entry.wake != cache->wake) {
+            continue;
+        }
+        memmove(cache->data + used, cache->data + entry.offset, entry.size);
+        entry.offset = used;
+        used += entry.size;
+        cache->entries[count++] = entry;
+    }
+    cache->count = count;
+    cache->size = used;
+    cache->wake++;
 }
 
-int calculate_width(const char* str, const tFont* font)
+/**
+ *  @brief: key of a string in the text cache, 0 when there is no cache or
+ *          the font is not packed by the tools
+ */
+static uint32_t text_cache_key(TextCache* cache, const char* str, const tFont* font)
 {
-    int width = 0;
+    uint32_t key;
 
-    int len = strlen(str);
-    int index = 0;
-    int code = 0;
-    int nextIndex;
-    while (index < len) {
-        if (utf8_next_char(str, index, &code, &nextIndex) != 0) {
-            const tChar* ch = find_char_by_code(code, font);
-            if (ch != 0) {
-                width += ch->image->width;
-            }
+    if (cache == NULL || font->packed == NULL || font->packed->hash == 0) {
+        return 0;
+    }
+    key = hash_bytes(font->packed->hash, str, strlen(str));
+    return key != 0 ? key : 1;
+}
+
+static TextCacheEntry* find_cached_string(TextCache* cache, uint32_t key)
+{
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].key == key) {
+            return &cache->entries[i];
         }
-        index = nextIndex;
-        if (nextIndex < 0)
-            break;
     }
+    return NULL;
+}
 
-    return width;
+static void draw_cached_string(Paint* paint, const TextCacheEntry* entry, int x, int y, int ink)
+{
+    blit_bitmap(paint, x + entry->left, y + entry->top, paint->text_cache->data + entry->offset, 0,
+        (entry->box_width + 7) / 8 * 8, entry->box_width, entry->box_height, ink, 1, 1);
 }
 
-void draw_bitmap_mono(int x, int y, const tImage* image)
+/**
+ *  @brief: whether there is room for a new entry with size bytes of bitmap
+ */
+static inline int has_room(const TextCache* cache, int size)
 {
-    uint8_t value = 0;
-    int x0, y0;
-    int counter = 0;
-    const uint8_t* pdata = (const uint8_t*)image->data;
+    return cache->count < TEXT_CACHE_ENTRIES && cache->size + size <= TEXT_CACHE_SIZE;
+}
 
-    // rows
-    for (y0 = 0; y0 < image->height; y0++) {
-        // columns
-        counter = 0;
-        for (x0 = 0; x0 < image->width; x0++) {
-            // load new data
-            if (counter == 0) {
-                value = *pdata++;
-                counter = image->dataSize;
-            }
-            counter--;
+/**
+ *  @brief: render the glyphs of a run into a new bitmap at the end of the
+ *          cache, unrotated and with rows of whole bytes like a tImage.
+ *          glyphs only add their colored pixels, like draw_glyphs() does.
+ */
+static void render_cached_string(TextCache* cache, TextCacheEntry* entry, const GlyphRun* run)
+{
+    const tPackedFont* font = run->font->packed;
+    int stride = (entry->box_width + 7) / 8;
+    uint8_t* data = cache->data + entry->offset;
+    // the cache holds bitmap bytes, set bits are uncolored
+    InkBytes colored = { 0x00, 0x00 };
+    int x = 0;
 
-            if (x0 < image->width) {
-                // set pixel
-                if ((value & 0x80) != 0)
-                    draw_pixel(x + x0, y + y0, 0);
-                else
-                    draw_pixel(x + x0, y + y0, 1);
-            }
+    memset(data, 0xFF, entry->size);
+    for (int i = 0; i < run->count; i++) {
+        const tGlyph* glyph = &font->glyphs[run->glyphs[i]];
+        uint32_t bit = glyph->offset;
+        uint8_t* row = data + (glyph->top - entry->top) * stride;
 
-            value = value << 1;
+        for (int y = 0; glyph->width != 0 && y < glyph->height; y++) {
+            blit_row_inked(row, NULL, x + glyph->left - entry->left, font->atlas + bit / 8, bit % 8, glyph->width, colored);
+            bit += glyph->width;
+            row += stride;
+        }
+        x += run->advances[i];
+    }
+}
+
+/**
+ *  @brief: add a string that was drawn from its glyphs to the cache. the
+ *          first time only its key is kept, the bitmap is rendered when
+ *          the string is drawn again in a later wake, so strings that
+ *          change with every wake do not take the room of the ones that
+ *          stay. a string drawn more than once in a wake, like one on two
+ *          bands of a banded frame, only counts once.
+ */
+static void remember_string(TextCache* cache, const MeasuredString* string)
+{
+    const tPackedFont* font = string->run.font->packed;
+    TextCacheEntry entry = { 0 };
+    int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+    int inked = 0;
+    int x = 0;
+    int size;
+
+    entry.key = string->key;
+    entry.wake = cache->wake;
+    entry.width = string->width;
+    if (string->cached != NULL && string->cached->wake == cache->wake) {
+        return;
+    }
+    if (string->cached == NULL) {
+        if (has_room(cache, 0)) {
+            entry.offset = cache->size;
+            cache->entries[cache->count++] = entry;
+        }
+        return;
+    }
+
+    for (int i = 0; i < string->run.count; i++) {
+        const tGlyph* glyph = &font->glyphs[string->run.glyphs[i]];
+
+        if (glyph->width != 0 && glyph->height != 0) {
+            if (!inked) {
+                x0 = x + glyph->left;
+                x1 = x0 + glyph->width;
+                y0 = glyph->top;
+                y1 = y0 + glyph->height;
+                inked = 1;
+            } else {
+                x0 = x + glyph->left < x0 ? x + glyph->left : x0;
+                x1 = x + glyph->left + glyph->width > x1 ? x + glyph->left + glyph->width : x1;
+                y0 = glyph->top < y0 ? glyph->top : y0;
+                y1 = glyph->top + glyph->height > y1 ? glyph->top + glyph->height : y1;
+            }
         }
+        x += string->run.advances[i];
+    }
+    size = (x1 - x0 + 7) / 8 * (y1 - y0);
+    if (size == 0 || size > TEXT_CACHE_SIZE) {
+        return;
     }
+    entry.left = x0;
+    entry.top = y0;
+    entry.box_width = x1 - x0;
+    entry.box_height = y1 - y0;
+
+    // the entry without bitmap is replaced by one at the end of the cache
+    int index = string->cached - cache->entries;
+    memmove(&cache->entries[index], &cache->entries[index + 1], (cache->count - index - 1) * sizeof(TextCacheEntry));
+    cache->count--;
+    if (!has_room(cache, size)) {
+        entry.offset = cache->size;
+        cache->entries[cache->count++] = entry;
+        return;
+    }
+    entry.offset = cache->size;
+    entry.size = size;
+    cache->entries[cache->count++] = entry;
+    cache->size += size;
+    render_cached_string(cache, &cache->entries[cache->count - 1], &string->run);
 }
 
 /**
 *  @brief: this draws a line on the frame buffer
 */
-void draw_line(int x0, int y0, int x1, int y1, int colored)
+void draw_line(Paint* paint, int x0, int y0, int x1, int y1, int ink)
 {
     /* Bresenham algorithm */
     int dx = x1 - x0 >= 0 ? x1 - x0 : x0 - x1;
@@ -292,8 +1804,10 @@ void draw_line(int x0, int y0, int x1, int y1, int colored)
     int sy = y0 < y1 ? 1 : -1;
     int err = dx + dy;
 
+    mark_rotated_dirty(paint, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, dx + 1, 1 - dy);
+
     while ((x0 != x1) && (y0 != y1)) {
-        draw_pixel(x0, y0, colored);
+        draw_rotated_pixel(paint, x0, y0, ink);
         if (2 * err >= dy) {
             err += dy;
             x0 += sx;
@@ -308,29 +1822,23 @@ void draw_line(int x0, int y0, int x1, int y1, int colored)
 /**
 *  @brief: this draws a horizontal line on the frame buffer
 */
-void draw_horizontal_line(int x, int y, int line_width, int colored)
+void draw_horizontal_line(Paint* paint, int x, int y, int line_width, int ink)
 {
-    int i;
-    for (i = x; i < x + line_width; i++) {
-        draw_pixel(i, y, colored);
-    }
+    fill_rectangle(paint, x, y, line_width, 1, ink);
 }
 
 /**
 *  @brief: this draws a vertical line on the frame buffer
 */
-void draw_vertical_line(int x, int y, int line_height, int colored)
+void draw_vertical_line(Paint* paint, int x, int y, int line_height, int ink)
 {
-    int i;
-    for (i = y; i < y + line_height; i++) {
-        draw_pixel(x, i, colored);
-    }
+    fill_rectangle(paint, x, y, 1, line_height, ink);
 }
 
 /**
 *  @brief: this draws a rectangle
 */
-void draw_rectangle(int x0, int y0, int x1, int y1, int colored)
+void draw_rectangle(Paint* paint, int x0, int y0, int x1, int y1, int ink)
 {
     int min_x, min_y, max_x, max_y;
     min_x = x1 > x0 ? x0 : x1;
@@ -338,33 +1846,30 @@ void draw_rectangle(int x0, int y0, int x1, int y1, int colored)
     min_y = y1 > y0 ? y0 : y1;
     max_y = y1 > y0 ? y1 : y0;
 
-    draw_horizontal_line(min_x, min_y, max_x - min_x + 1, colored);
-    draw_horizontal_line(min_x, max_y, max_x - min_x + 1, colored);
-    draw_vertical_line(min_x, min_y, max_y - min_y + 1, colored);
-    draw_vertical_line(max_x, min_y, max_y - min_y + 1, colored);
+    draw_horizontal_line(paint, min_x, min_y, max_x - min_x + 1, ink);
+    draw_horizontal_line(paint, min_x, max_y, max_x - min_x + 1, ink);
+    draw_vertical_line(paint, min_x, min_y, max_y - min_y + 1, ink);
+    draw_vertical_line(paint, max_x, min_y, max_y - min_y + 1, ink);
 }
 
 /**
 *  @brief: this draws a filled rectangle
 */
-void draw_filled_rectangle(int x0, int y0, int x1, int y1, int colored)
+void draw_filled_rectangle(Paint* paint, int x0, int y0, int x1, int y1, int ink)
 {
     int min_x, min_y, max_x, max_y;
-    int i;
     min_x = x1 > x0 ? x0 : x1;
     max_x = x1 > x0 ? x1 : x0;
     min_y = y1 > y0 ? y0 : y1;
     max_y = y1 > y0 ? y1 : y0;
 
-    for (i = min_x; i <= max_x; i++) {
-        draw_vertical_line(i, min_y, max_y - min_y + 1, colored);
-    }
+    fill_rectangle(paint, min_x, min_y, max_x - min_x + 1, max_y - min_y + 1, ink);
 }
 
 /**
 *  @brief: this draws a circle
 */
-void draw_circle(int x, int y, int radius, int colored)
+void draw_circle(Paint* paint, int x, int y, int radius, int ink)
 {
     /* Bresenham algorithm */
     int x_pos = -radius;
@@ -372,11 +1877,13 @@ void draw_circle(int x, int y, int radius, int colored)
     int err = 2 - 2 * radius;
     int e2;
 
+    mark_rotated_dirty(paint, x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
+
     do {
-        draw_pixel(x - x_pos, y + y_pos, colored);
-        draw_pixel(x + x_pos, y + y_pos, colored);
-        draw_pixel(x + x_pos, y - y_pos, colored);
-        draw_pixel(x - x_pos, y - y_pos, colored);
+        draw_rotated_pixel(paint, x - x_pos, y + y_pos, ink);
+        draw_rotated_pixel(paint, x + x_pos, y + y_pos, ink);
+        draw_rotated_pixel(paint, x + x_pos, y - y_pos, ink);
+        draw_rotated_pixel(paint, x - x_pos, y - y_pos, ink);
         e2 = err;
         if (e2 <= y_pos) {
             err += ++y_pos * 2 + 1;
@@ -393,7 +1900,7 @@ void draw_circle(int x, int y, int radius, int colored)
 /**
 *  @brief: this draws a filled circle
 */
-void draw_filled_circle(int x, int y, int radius, int colored)
+void draw_filled_circle(Paint* paint, int x, int y, int radius, int ink)
 {
     /* Bresenham algorithm */
     int x_pos = -radius;
@@ -401,13 +1908,15 @@ void draw_filled_circle(int x, int y, int radius, int colored)
     int err = 2 - 2 * radius;
     int e2;
 
+    mark_rotated_dirty(paint, x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
+
     do {
-        draw_pixel(x - x_pos, y + y_pos, colored);
-        draw_pixel(x + x_pos, y + y_pos, colored);
-        draw_pixel(x + x_pos, y - y_pos, colored);
-        draw_pixel(x - x_pos, y - y_pos, colored);
-        draw_horizontal_line(x + x_pos, y + y_pos, 2 * (-x_pos) + 1, colored);
-        draw_horizontal_line(x + x_pos, y - y_pos, 2 * (-x_pos) + 1, colored);
+        draw_rotated_pixel(paint, x - x_pos, y + y_pos, ink);
+        draw_rotated_pixel(paint, x + x_pos, y + y_pos, ink);
+        draw_rotated_pixel(paint, x + x_pos, y - y_pos, ink);
+        draw_rotated_pixel(paint, x - x_pos, y - y_pos, ink);
+        draw_horizontal_line(paint, x + x_pos, y + y_pos, 2 * (-x_pos) + 1, ink);
+        draw_horizontal_line(paint, x + x_pos, y - y_pos, 2 * (-x_pos) + 1, ink);
         e2 = err;
         if (e2 <= y_pos) {
             err += ++y_pos * 2 + 1;
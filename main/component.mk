@@ -7,3 +7,11 @@
 # please read the ESP-IDF documents if you need to do this.
 #
 
+# weather_icons.h for darksky.h, generated like in components/darksky
+COMPONENT_EXTRA_INCLUDES := $(COMPONENT_BUILD_DIR)
+COMPONENT_EXTRA_CLEAN := weather_icons.h
+
+main.o: weather_icons.h
+
+weather_icons.h: $(COMPONENT_PATH)/weather_icons.txt $(PROJECT_PATH)/components/darksky/darksky_icons.txt $(PROJECT_PATH)/tools/icon_registry.py
+	$(PYTHON) $(PROJECT_PATH)/tools/icon_registry.py -o $@ $(COMPONENT_PATH)/weather_icons.txt darksky=$(PROJECT_PATH)/components/darksky/darksky_icons.txt
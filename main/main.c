@@ -26,22 +26,16 @@
 
 #include "epdpaint.h"
 
-#include "icons.h"
-
-#include "ubuntu10.h"
-#include "ubuntu12.h"
-#include "ubuntu14.h"
-#include "ubuntu16.h"
-#include "ubuntu18.h"
-#include "ubuntu20.h"
-#include "ubuntu22.h"
-#include "ubuntu24.h"
-#include "ubuntu8.h"
+/* Fonts and icons are read from the asset partition, see tools/asset_image.py */
+#include "assets.h"
 
 #include "ota.h"
 
-#define COLORED 1
-#define UNCOLORED 0
+/* Weather drawn in red on the display */
+#define WARN_TEMPERATURE_LOW -10
+#define WARN_TEMPERATURE_HIGH 30
+#define WARN_WIND_SPEED_KMH 62
+#define WARN_PRECIP_PROBABILITY 70
 
 QueueHandle_t msgQueue;
 
@@ -58,6 +52,10 @@ EventGroupHandle_t wifi_event_group;
    to the AP with an IP? */
 const int CONNECTED_BIT = BIT0;
 
+/* Set when the weather is drawn and sent to the display, or could not be */
+EventGroupHandle_t display_event_group;
+const int DRAWN_BIT = BIT0;
+
 /* Variable holding number of times ESP32 restarted since first boot.
 * It is placed into RTC memory using RTC_DATA_ATTR and
 * maintains its value when ESP32 wakes from deep sleep.
@@ -65,6 +63,12 @@ const int CONNECTED_BIT = BIT0;
 RTC_DATA_ATTR static int boot_count = 0;
 RTC_DATA_ATTR static time_t time_updated = 0;
 
+/* Band hashes of the frame on the display, to skip refreshing an identical frame after deep sleep */
+RTC_DATA_ATTR static FrameHistory frame_history;
+
+/* Strings drawn in the wakes before, rendered once and blitted from RTC memory */
+RTC_DATA_ATTR static TextCache text_cache;
+
 /**
  * place times you want your display to be updated in this array
  * examples:
@@ -94,8 +98,8 @@ static int update_times[] = {
 };
 
 extern Forecast forecasts[8];
-extern char summary[50];
-extern char icon[20];
+extern char summary[128];
+extern WeatherIcon icon;
 extern double temperature;
 extern double humidity;
 extern int pressure;
@@ -189,14 +193,128 @@ static void obtain_time(void)
     }
 }
 
-static void weather_to_display_task(void* pvParameters)
+/* Everything the weather frame shows, prepared once and drawn for every band of the display */
+typedef struct {
+    const tFont* ubuntu10;
+    const tFont* ubuntu12;
+    const tFont* ubuntu24;
+    const tImage* image;
+    char temperature[30];
+    int temperature_ink;
+    TextLayout summary_layout;
+    int row_offset;
+    char humidity[30];
+    char pressure[30];
+    char wind[30];
+    int wind_ink;
+    char precip[40];
+    int precip_ink;
+    struct {
+        char day[20];
+        char date[20];
+        char temperature[30];
+        int temperature_ink;
+        const tImage* image;
+    } days[sizeof(forecasts) / sizeof(Forecast)];
+    char updated[64];
+} WeatherFrame;
+
+static WeatherFrame weather_frame;
+
+/**
+ *  @brief: draw the weather frame, display_banded_frame() calls this for
+ *          every band
+ */
+static void draw_weather_frame(Paint* paint, void* arg)
+{
+    const WeatherFrame* frame = (const WeatherFrame*)arg;
+
+    paint_set_text_cache(paint, &text_cache);
+    clear(paint, INK_WHITE);
+
+    // Current weather
+    if (frame->image != NULL) {
+        draw_bitmap_mono_in_center(paint, 2, 0, 500, 40, frame->image, INK_BLACK);
+    }
+
+    draw_string_in_grid_align_center(paint, 3, 0, 400, 45, frame->temperature, frame->ubuntu24, frame->temperature_ink);
+
+    draw_paragraph(paint, &frame->summary_layout, 400 / 2, 65, 400 / 2, TEXT_ALIGN_CENTER, INK_BLACK);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, frame->row_offset + 85, frame->humidity, frame->ubuntu12, INK_BLACK);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, frame->row_offset + 105, frame->pressure, frame->ubuntu12, INK_BLACK);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, frame->row_offset + 125, frame->wind, frame->ubuntu12, frame->wind_ink);
+    draw_string_in_grid_align_center(paint, 2, 1, 400, frame->row_offset + 145, frame->precip, frame->ubuntu12, frame->precip_ink);
+
+    for (size_t i = 0; i < (sizeof(frame->days) / sizeof(frame->days[0])); i++) {
+        draw_string_in_grid_align_center(paint, 7, i, 400, 210, frame->days[i].day, frame->ubuntu10, INK_BLACK);
+
+        draw_string_in_grid_align_center(paint, 7, i, 400, 225, frame->days[i].date, frame->ubuntu10, INK_BLACK);
+
+        draw_string_in_grid_align_center(paint, 7, i, 400, 240, frame->days[i].temperature, frame->ubuntu10,
+            frame->days[i].temperature_ink);
+
+        if (frame->days[i].image != NULL) {
+            draw_bitmap_mono_in_center(paint, 7, i, 400, 255, frame->days[i].image, INK_BLACK);
+        }
+    }
+
+    draw_string_in_grid_align_left(paint, 1, 0, 2, 400, 0, CONFIG_PLACE_NAME, frame->ubuntu12, INK_BLACK);
+    draw_string_in_grid_align_right(paint, 1, 0, 2, 400, 0, frame->updated, frame->ubuntu12, INK_BLACK);
+
+    draw_horizontal_line(paint, 0, 14, 400, INK_BLACK);
+    draw_horizontal_line(paint, 0, 200, 400, INK_BLACK);
+    draw_horizontal_line(paint, 0, 0, 400, INK_BLACK);
+    draw_vertical_line(paint, 0, 0, 300, INK_BLACK);
+    draw_horizontal_line(paint, 0, 299, 400, INK_BLACK);
+    draw_vertical_line(paint, 399, 0, 300, INK_BLACK);
+
+    for (size_t i = 1; i < 7; i++) {
+        draw_vertical_line(paint, (400 / 7 * i), 200, 138, INK_BLACK);
+    }
+}
+
+/**
+ *  @brief: draw a red cross in a red frame, shown instead of the weather
+ *          when there are no fonts to draw it with
+ */
+static void draw_asset_error(Paint* paint, void* arg)
+{
+    clear(paint, INK_WHITE);
+    draw_rectangle(paint, 0, 0, 399, 299, INK_RED);
+    draw_line(paint, 0, 0, 399, 299, INK_RED);
+    draw_line(paint, 0, 299, 399, 0, INK_RED);
+}
+
+static void show_asset_error(void)
+{
+    if (epd4in2b_init() == 0) {
+        display_banded_frame_async(draw_asset_error, NULL, 1, &frame_history, 1);
+    }
+}
+
+static void weather_to_display(void)
 {
     static const char* TAG = "weather_to_display_task";
 
+    WeatherFrame* frame = &weather_frame;
     time_t now;
     struct tm timeinfo;
 
-    char tmp_buff[30];
+    if (assets_open(ASSET_PARTITION_LABEL) != 0) {
+        ESP_LOGE(TAG, "Assets missing or corrupt, flash them with make assets-flash");
+        show_asset_error();
+        return;
+    }
+
+    frame->ubuntu10 = asset_font("Ubuntu10");
+    frame->ubuntu12 = asset_font("Ubuntu12");
+    frame->ubuntu24 = asset_font("Ubuntu24");
+
+    if (frame->ubuntu10 == NULL || frame->ubuntu12 == NULL || frame->ubuntu24 == NULL) {
+        ESP_LOGE(TAG, "Fonts missing from the assets, flash them with make assets-flash");
+        show_asset_error();
+        return;
+    }
 
     if (epd4in2b_init() != 0) {
         ESP_LOGE(TAG, "e-Paper init failed");
@@ -205,146 +323,77 @@ static void weather_to_display_task(void* pvParameters)
     }
     ESP_LOGE(TAG, "e-Paper initialized");
 
-    clear_frame();
-
-    unsigned char* frame_black = (unsigned char*)malloc(400 * 300 / 8);
-
-    if (frame_black == NULL) {
-        ESP_LOGE(TAG, "error");
-    }
-
-    paint(frame_black, 400, 300);
-
-    clear(UNCOLORED);
-
     // Current weather
-    const tImage* image = NULL;
-
-    if (strcmp(icon, "clear-day") == 0) {
-        image = &widaysunny;
-    } else if (strcmp(icon, "clear-night") == 0) {
-        image = &winightclear;
-    } else if (strcmp(icon, "rain") == 0) {
-        image = &wirain;
-    } else if (strcmp(icon, "snow") == 0) {
-        image = &wisnow;
-    } else if (strcmp(icon, "sleet") == 0) {
-        image = &wisleet;
-    } else if (strcmp(icon, "wind") == 0) {
-        image = &wistrongwind;
-    } else if (strcmp(icon, "fog") == 0) {
-        image = &wifog;
-    } else if (strcmp(icon, "cloudy") == 0) {
-        image = &wicloudy;
-    } else if (strcmp(icon, "partly-cloudy-day") == 0) {
-        image = &widaycloudy;
-    } else if (strcmp(icon, "partly-cloudy-night") == 0) {
-        image = &winightaltcloudy;
-    }
+    frame->image = NULL;
 
-    if (image != NULL) {
-        draw_bitmap_mono_in_center(2, 0, 500, 40, image);
+    if (icon != WEATHER_ICON_NONE) {
+        frame->image = asset_image(weather_icon_assets(icon)->large);
     }
 
-    sprintf(tmp_buff, "%0.1f º", temperature);
-    draw_string_in_grid_align_center(3, 0, 400, 45, tmp_buff, &Ubuntu24);
+    sprintf(frame->temperature, "%0.1f º", temperature);
+    frame->temperature_ink = temperature <= WARN_TEMPERATURE_LOW || temperature >= WARN_TEMPERATURE_HIGH ? INK_RED : INK_BLACK;
+
+    // A summary that does not fit in the column takes two lines, the rows below move down
+    int summary_lines = layout_paragraph(&frame->summary_layout, summary, frame->ubuntu12, 400 / 2, 2);
+    frame->row_offset = summary_lines > 1 ? font_line_height(frame->ubuntu12) : 0;
 
-    draw_string_in_grid_align_center(2, 1, 400, 65, summary, &Ubuntu12);
+    sprintf(frame->humidity, "Humidity: %d%%", (int)(humidity * 100));
 
-    sprintf(tmp_buff, "Humidity: %d%%", (int)(humidity * 100));
-    draw_string_in_grid_align_center(2, 1, 400, 85, tmp_buff, &Ubuntu12);
+    sprintf(frame->pressure, "Pressure:%d hPa", pressure);
 
-    sprintf(tmp_buff, "Pressure:%d hPa", pressure);
-    draw_string_in_grid_align_center(2, 1, 400, 105, tmp_buff, &Ubuntu12);
+    int wind_kmh = (int)round(wind_speed * 3.6);
+    sprintf(frame->wind, "Wind :%d km/h (%s)", wind_kmh, deg_to_compass(wind_bearing));
+    frame->wind_ink = wind_kmh >= WARN_WIND_SPEED_KMH ? INK_RED : INK_BLACK;
 
-    sprintf(tmp_buff, "Wind :%d km/h (%s)", (int)round(wind_speed * 3.6), deg_to_compass(wind_bearing));
-    draw_string_in_grid_align_center(2, 1, 400, 125, tmp_buff, &Ubuntu12);
+    int precip_percent = (int)round(precip_probability * 100);
+    sprintf(frame->precip, "Chance of Precipitation : %d%%", precip_percent);
+    frame->precip_ink = precip_percent >= WARN_PRECIP_PROBABILITY ? INK_RED : INK_BLACK;
 
-    sprintf(tmp_buff, "Chance of Precipitation : %d%%", (int)round(precip_probability * 100));
-    draw_string_in_grid_align_center(2, 1, 400, 145, tmp_buff, &Ubuntu12);
+    setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0", 1);
+    tzset();
 
     for (size_t i = 0; i < (sizeof(forecasts) / sizeof(Forecast)); i++) {
-        struct tm timeinfo;
-        setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0", 1);
-        tzset();
         localtime_r(&forecasts[i].time, &timeinfo);
-        char day[20];
-        char date[20];
-        strftime(date, sizeof(date), "%d - %m", &timeinfo);
-        strftime(day, sizeof(date), "%A", &timeinfo);
+        strftime(frame->days[i].date, sizeof(frame->days[i].date), "%d - %m", &timeinfo);
+        strftime(frame->days[i].day, sizeof(frame->days[i].day), "%A", &timeinfo);
 
         if (i == 0) {
-            sprintf(day, "Today");
+            sprintf(frame->days[i].day, "Today");
         }
 
         if (i == 1) {
-            sprintf(day, "Tomorrow");
+            sprintf(frame->days[i].day, "Tomorrow");
         }
 
-        draw_string_in_grid_align_center(7, i, 400, 210, day, &Ubuntu10);
-
-        draw_string_in_grid_align_center(7, i, 400, 225, date, &Ubuntu10);
-
-        sprintf(tmp_buff, "%d - %d º", (int)round(forecasts[i].temperatureMin), (int)round(forecasts[i].temperatureMax));
-        draw_string_in_grid_align_center(7, i, 400, 240, tmp_buff, &Ubuntu10);
-
-        const tImage* forecast_image = NULL;
-
-        if (strcmp(forecasts[i].icon, "clear-day") == 0) {
-            forecast_image = &daysunny;
-        } else if (strcmp(forecasts[i].icon, "clear-night") == 0) {
-            forecast_image = &nightclear;
-        } else if (strcmp(forecasts[i].icon, "rain") == 0) {
-            forecast_image = &rain;
-        } else if (strcmp(forecasts[i].icon, "snow") == 0) {
-            forecast_image = &snow;
-        } else if (strcmp(forecasts[i].icon, "sleet") == 0) {
-            forecast_image = &sleet;
-        } else if (strcmp(forecasts[i].icon, "wind") == 0) {
-            forecast_image = &strongwind;
-        } else if (strcmp(forecasts[i].icon, "fog") == 0) {
-            forecast_image = &fog;
-        } else if (strcmp(forecasts[i].icon, "cloudy") == 0) {
-            forecast_image = &cloudy;
-        } else if (strcmp(forecasts[i].icon, "partly-cloudy-day") == 0) {
-            forecast_image = &daycloudy;
-        } else if (strcmp(forecasts[i].icon, "partly-cloudy-night") == 0) {
-            forecast_image = &nightaltcloudy;
-        }
+        int temperature_min = (int)round(forecasts[i].temperatureMin);
+        int temperature_max = (int)round(forecasts[i].temperatureMax);
+        sprintf(frame->days[i].temperature, "%d - %d º", temperature_min, temperature_max);
+        frame->days[i].temperature_ink = temperature_min <= WARN_TEMPERATURE_LOW || temperature_max >= WARN_TEMPERATURE_HIGH ? INK_RED : INK_BLACK;
 
-        if (forecast_image != NULL) {
-            draw_bitmap_mono_in_center(7, i, 400, 255, forecast_image);
+        frame->days[i].image = NULL;
+
+        if (forecasts[i].icon != WEATHER_ICON_NONE) {
+            frame->days[i].image = asset_image(weather_icon_assets(forecasts[i].icon)->small);
         }
     }
 
-    draw_string_in_grid_align_left(1, 0, 2, 400, 0, CONFIG_PLACE_NAME, &Ubuntu12);
-
     time(&now);
-    char strftime_buf[64];
     // Set timezone to Eastern Standard Time and print local time
-    setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0", 1);
-    tzset();
     localtime_r(&now, &timeinfo);
-    strftime(strftime_buf, sizeof(strftime_buf), "Last updated: %e %b %H:%M", &timeinfo);
-
-    draw_string_in_grid_align_right(1, 0, 2, 400, 0, strftime_buf, &Ubuntu12);
+    strftime(frame->updated, sizeof(frame->updated), "Last updated: %e %b %H:%M", &timeinfo);
 
-    draw_horizontal_line(0, 14, 400, COLORED);
-    draw_horizontal_line(0, 200, 400, COLORED);
-    draw_horizontal_line(0, 0, 400, COLORED);
-    draw_vertical_line(0, 0, 300, COLORED);
-    draw_horizontal_line(0, 299, 400, COLORED);
-    draw_vertical_line(399, 0, 300, COLORED);
+    text_cache_begin(&text_cache);
 
-    for (size_t i = 1; i < 7; i++) {
-        draw_vertical_line((400 / 7 * i), 200, 138, COLORED);
+    // /* Draw and send the frame band by band, app_main waits until it is on the display */
+    if (display_banded_frame_async(draw_weather_frame, frame, 1, &frame_history, 1) != 0) {
+        ESP_LOGE(TAG, "e-Paper is still busy");
     }
+}
 
-    // /* Display the frame buffer */
-    display_frame(NULL, frame_black);
-
-    epd4in2_sleep();
-
+static void weather_to_display_task(void* pvParameters)
+{
+    weather_to_display();
+    xEventGroupSetBits(display_event_group, DRAWN_BIT);
     vTaskDelete(NULL);
 }
 
@@ -405,10 +454,11 @@ void app_main(void)
 
             deinitialize_wifi();
 
+            display_event_group = xEventGroupCreate();
             xTaskCreate(&weather_to_display_task, "weather_to_display_task", 8192, NULL, 5, NULL);
+            xEventGroupWaitBits(display_event_group, DRAWN_BIT, pdFALSE, pdTRUE, 30000 / portTICK_PERIOD_MS);
 
-            vTaskDelay(5000 / portTICK_PERIOD_MS);
-
+            // The display refreshes while the next wake up is worked out
             time_t now;
             struct tm timeinfo;
 
@@ -434,6 +484,14 @@ void app_main(void)
             if (!sleep_time_set) {
                 deep_sleep_sec = (24 * 60 - seconds_of_today_ahead) + (update_times[0] * 60);
             }
+
+            // Every wait for the display ends after BUSY_TIMEOUT_MS, a refresh and power off take two
+            int changed_bands = epd_wait_idle(2 * BUSY_TIMEOUT_MS + 1000);
+            if (changed_bands < 0) {
+                ESP_LOGE(TAG, "e-Paper hangs or no frame was started, the frame is sent again after the next wake up");
+            } else {
+                ESP_LOGI(TAG, "%d of %d bands changed", changed_bands, EPD_FRAME_BANDS);
+            }
         }
     }
 
@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -3444,4 +3445,4 @@ static const tChar Ubuntu10_array[] = {
 
 };
 
-const tFont Ubuntu10 = { 126, Ubuntu10_array };
+const tFont Ubuntu10 = { 126, Ubuntu10_array, Ubuntu10_RANGES };
@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -3822,4 +3823,4 @@ static const tChar Ubuntu12_array[] = {
 
 };
 
-const tFont Ubuntu12 = { 126, Ubuntu12_array };
+const tFont Ubuntu12 = { 126, Ubuntu12_array, Ubuntu12_RANGES };
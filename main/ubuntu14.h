@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -4074,4 +4075,4 @@ static const tChar Ubuntu14_array[] = {
 
 };
 
-const tFont Ubuntu14 = { 126, Ubuntu14_array };
+const tFont Ubuntu14 = { 126, Ubuntu14_array, Ubuntu14_RANGES };
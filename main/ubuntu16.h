@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -4326,4 +4327,4 @@ static const tChar Ubuntu16_array[] = {
 
 };
 
-const tFont Ubuntu16 = { 126, Ubuntu16_array };
+const tFont Ubuntu16 = { 126, Ubuntu16_array, Ubuntu16_RANGES };
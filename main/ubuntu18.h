@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -4578,4 +4579,4 @@ static const tChar Ubuntu18_array[] = {
 
 };
 
-const tFont Ubuntu18 = { 126, Ubuntu18_array };
+const tFont Ubuntu18 = { 126, Ubuntu18_array, Ubuntu18_RANGES };
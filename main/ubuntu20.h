@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -4830,4 +4831,4 @@ static const tChar Ubuntu20_array[] = {
 
 };
 
-const tFont Ubuntu20 = { 126, Ubuntu20_array };
+const tFont Ubuntu20 = { 126, Ubuntu20_array, Ubuntu20_RANGES };
@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -5208,4 +5209,4 @@ static const tChar Ubuntu22_array[] = {
 
 };
 
-const tFont Ubuntu22 = { 126, Ubuntu22_array };
+const tFont Ubuntu22 = { 126, Ubuntu22_array, Ubuntu22_RANGES };
@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -5460,4 +5461,4 @@ static const tChar Ubuntu24_array[] = {
 
 };
 
-const tFont Ubuntu24 = { 126, Ubuntu24_array };
+const tFont Ubuntu24 = { 126, Ubuntu24_array, Ubuntu24_RANGES };
@@ -36,6 +36,7 @@
 */
 
 #include "image.h"
+#include "font_ranges.h"
 #include <stdint.h>
 
 #if (0x0 == 0x0)
@@ -3192,4 +3193,4 @@ static const tChar Ubuntu8_array[] = {
 
 };
 
-const tFont Ubuntu8 = { 126, Ubuntu8_array };
+const tFont Ubuntu8 = { 126, Ubuntu8_array, Ubuntu8_RANGES };
@@ -0,0 +1,250 @@
+#!/usr/bin/env python
+#
+# Builds the image of the asset partition from the headers made by LCD Image
+# Converter: every tImage of an icon header becomes an image asset, trimmed to
+# the box of its ink and compressed to IMAGE_RLE when that is smaller, and
+# every tFont becomes a packed font
+# asset, compiled like tools/font_compiler.py does. The firmware maps the
+# partition and draws the assets where they are, see assets.h.
+#
+# All values are little endian, every record starts at a multiple of 4 bytes:
+#
+#   header   magic "EPDA", uint16 version, uint16 count, uint32 size
+#   index    count entries: char name[24], uint32 type, uint32 offset,
+#            uint32 size. offsets are from the start of the image.
+#   image    uint16 width, uint16 height, uint8 dataSize, uint8 compression,
+#            uint16 0, uint16 left, uint16 top, uint16 full_width,
+#            uint16 full_height, followed by the data of the width x height
+#            box at left, top of the full image
+#   font     uint16 length, uint8 height, uint8 baseline, uint16 range_count,
+#            uint16 kerning_count, uint32 hash, followed by range_count
+#            tFontRange, length tGlyph, kerning_count tKernPair and the atlas
+#
+# The fonts either all get the codepoints given with -c, or a fonts file
+# lists the fonts to keep and the codepoints of each. It has a line for every
+# font: its name and a list of codepoints like -c takes, @file relative to
+# the fonts file. Fonts that are not listed are left out.
+#
+# A font gets the kerning pairs of the file given for its name with -k, see
+# tools/font_compiler.py for the format.
+#
+# usage: asset_image.py -f fonts.txt [-k ubuntu12=ubuntu12.kern] -o assets.bin icons.h ubuntu*.h
+#
+
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+# the other tools are imported from the source tree, keep it clean of .pyc files
+sys.dont_write_bytecode = True
+from font_compiler import font_hash, glyph_metrics, load_font, pack, parse_codepoints, read_kerning  # noqa: E402
+from font_ranges import find_ranges  # noqa: E402
+from rle_assets import DATA_RE, compress_bitmap  # noqa: E402
+
+# Keep in sync with assets.h
+ASSET_MAGIC = 0x41445045
+ASSET_VERSION = 4
+ASSET_NAME_LENGTH = 24
+ASSET_IMAGE = 1
+ASSET_FONT = 2
+
+IMAGE_RAW = 0
+IMAGE_RLE = 1
+
+HEADER = struct.Struct("<IHHI")
+ENTRY = struct.Struct("<%dsIII" % ASSET_NAME_LENGTH)
+IMAGE = struct.Struct("<HHBBHHHHH")
+FONT = struct.Struct("<HBBHHI")
+RANGE = struct.Struct("<iii")
+GLYPH = struct.Struct("<iIBBbbHH")
+KERN_PAIR = struct.Struct("<Hh")
+
+TIMAGE_RE = re.compile(r"const\s+tImage\s+(\w+)\s*=\s*\{\s*(\w+)\s*,\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)")
+TFONT_RE = re.compile(r"const\s+tFont\s+\w+\s*=")
+
+
+def trim_bitmap(data, width, height):
+    """ (data, left, top, width, height) of the box of the colored pixels of
+        a bitmap stored in rows of whole bytes """
+    stride = (width + 7) // 8
+    if len(data) != stride * height:
+        raise ValueError("%d bytes for %dx%d pixels" % (len(data), width, height))
+
+    def colored(x, y):
+        return not (data[y * stride + x // 8] >> (7 - x % 8)) & 1
+
+    rows = [y for y in range(height) if any(colored(x, y) for x in range(width))]
+    if not rows:
+        return [], 0, 0, 0, 0
+    columns = [x for x in range(width) if any(colored(x, y) for y in rows)]
+    left, top = columns[0], rows[0]
+    box_width, box_height = columns[-1] + 1 - left, rows[-1] + 1 - top
+
+    trimmed = []
+    for y in range(top, top + box_height):
+        row = [0xff] * ((box_width + 7) // 8)
+        for x in range(box_width):
+            if colored(left + x, y):
+                row[x // 8] &= ~(0x80 >> (x % 8))
+        trimmed.extend(row)
+    return trimmed, left, top, box_width, box_height
+
+
+def read_images(path):
+    """ (name, record) of every tImage in a header """
+    with open(path) as f:
+        text = f.read()
+    arrays = {}
+    for match in DATA_RE.finditer(text):
+        arrays[match.group(2)] = [int(b, 16) for b in re.findall(r"0x[0-9a-fA-F]+", match.group(4))]
+
+    images = []
+    for match in TIMAGE_RE.finditer(text):
+        name, array = match.group(1), match.group(2)
+        width, height, data_size = int(match.group(3)), int(match.group(4)), int(match.group(5))
+        if array not in arrays:
+            raise ValueError("%s: no data for %s" % (path, name))
+        data = arrays[array]
+        compression = IMAGE_RAW
+        box = (0, 0, width, height)
+        if data_size == 8:
+            data, left, top, box_width, box_height = trim_bitmap(data, width, height)
+            box = (left, top, box_width, box_height)
+            rle = compress_bitmap(data, box_width, box_height) if data else None
+            if rle is not None:
+                data, compression = rle, IMAGE_RLE
+        record = IMAGE.pack(box[2], box[3], data_size, compression, 0, box[0], box[1], width, height)
+        images.append((name, record + bytearray(data)))
+    return images
+
+
+def read_fonts_file(path):
+    """ font name -> codepoints of every font of a fonts file """
+    fonts = {}
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split("#")[0].split(None, 1)
+            if not fields:
+                continue
+            if len(fields) != 2 or fields[0] in fonts:
+                raise ValueError("%s:%d: expected a font listed once and its codepoints" % (path, number))
+            spec = fields[1].strip()
+            if spec.startswith("@"):
+                spec = "@" + os.path.join(os.path.dirname(path), spec[1:])
+            try:
+                fonts[fields[0]] = parse_codepoints(spec)
+            except ValueError as e:
+                raise ValueError("%s:%d: %s" % (path, number, e))
+    return fonts
+
+
+def read_font(path, fonts, kerning):
+    """ (name, record) of the packed font compiled from a header, None
+        when it is left out. fonts maps font names to their codepoints, all
+        fonts get the codepoints of None when it has them. kerning maps font
+        names to kerning files. """
+    font = load_font(path, argparse.Namespace(baseline=None, size=None))
+    name = font.name or re.sub(r"\W", "_", os.path.splitext(os.path.basename(path))[0])
+    codepoints = fonts.get(name, fonts.get(None))
+    if codepoints is None:
+        return None
+    if name in kerning:
+        read_kerning(kerning[name], font)
+    missing = sorted(c for c in codepoints if c not in font.glyphs)
+    if missing:
+        print("%s: no glyphs for %s" % (path, ", ".join("U+%04X" % c for c in missing)), file=sys.stderr)
+    entries, atlas = pack(font, codepoints - set(missing))
+    try:
+        metrics, pairs = glyph_metrics(font, entries)
+    except ValueError as e:
+        raise ValueError("%s: %s" % (path, e))
+    ranges = find_ranges([metric[0] for metric in metrics])
+
+    height = font.ascent + font.descent
+    record = bytearray(FONT.pack(len(metrics), height, font.ascent, len(ranges), len(pairs),
+        font_hash(height, font.ascent, metrics, pairs, atlas)))
+    for r in ranges:
+        record += RANGE.pack(*r)
+    for metric in metrics:
+        record += GLYPH.pack(*metric)
+    for pair in pairs:
+        record += KERN_PAIR.pack(*pair)
+    return name, record + bytearray(atlas)
+
+
+def align(data):
+    return data + bytearray(-len(data) % 4)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the image of the asset partition")
+    parser.add_argument("-o", "--output", required=True, help="partition image")
+    selection = parser.add_mutually_exclusive_group(required=True)
+    selection.add_argument("-c", "--codepoints", help="codepoints of all fonts")
+    selection.add_argument("-f", "--fonts", help="file with the fonts to keep and their codepoints")
+    parser.add_argument("-k", "--kerning", action="append", default=[], help="font=file with kerning pairs of a font")
+    parser.add_argument("headers", nargs="+", help="icon and font headers from LCD Image Converter")
+    args = parser.parse_args()
+
+    kerning = {}
+    for spec in args.kerning:
+        name, _, path = spec.partition("=")
+        if not name or not path:
+            print("%s: expected font=file" % spec, file=sys.stderr)
+            return 1
+        kerning[name] = path
+    assets = []
+    found = set()
+    try:
+        if args.fonts:
+            fonts = read_fonts_file(args.fonts)
+        else:
+            fonts = {None: parse_codepoints(args.codepoints)}
+        for path in args.headers:
+            with open(path) as f:
+                is_font = TFONT_RE.search(f.read()) is not None
+            if not is_font:
+                assets.extend((ASSET_IMAGE,) + image for image in read_images(path))
+                continue
+            font = read_font(path, fonts, kerning)
+            if font is not None:
+                assets.append((ASSET_FONT,) + font)
+                found.add(font[0])
+    except (IOError, ValueError) as e:
+        print(e, file=sys.stderr)
+        return 1
+    missing = (set(fonts) | set(kerning)) - found - set([None])
+    if missing:
+        print("no fonts called %s" % ", ".join(sorted(missing)), file=sys.stderr)
+        return 1
+
+    names = [asset[1] for asset in assets]
+    for name in names:
+        if len(name) >= ASSET_NAME_LENGTH:
+            print("%s: name longer than %d characters" % (name, ASSET_NAME_LENGTH - 1), file=sys.stderr)
+            return 1
+        if names.count(name) > 1:
+            print("%s: more than one asset with this name" % name, file=sys.stderr)
+            return 1
+
+    index = bytearray()
+    records = bytearray()
+    offset = HEADER.size + ENTRY.size * len(assets)
+    for asset_type, name, record in assets:
+        index += ENTRY.pack(name.encode("ascii"), asset_type, offset + len(records), len(record))
+        records += align(record)
+
+    size = offset + len(records)
+    with open(args.output, "wb") as f:
+        f.write(HEADER.pack(ASSET_MAGIC, ASSET_VERSION, len(assets), size) + index + records)
+    fonts = sum(1 for asset in assets if asset[0] == ASSET_FONT)
+    print("%s: %d images, %d fonts, %d bytes" % (args.output, len(assets) - fonts, fonts, size))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
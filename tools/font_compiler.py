@@ -0,0 +1,548 @@
+#!/usr/bin/env python
+#
+# Compiles a font to a tPackedFont: one contiguous atlas with the bitmaps of
+# all glyphs, each cut to the bounding box of its ink, and per glyph metrics.
+#
+# Sources:
+#   .bdf         BDF bitmap font
+#   .pcf         PCF bitmap font, uncompressed
+#   .ttf .otf    outline font, rendered at --size pixels (needs freetype-py)
+#   .h           header made by LCD Image Converter, the glyphs are full cells
+#                so the baseline is taken from the bottom of the capitals and
+#                digits unless --baseline is given
+#
+# Codepoints are Unicode, given as a list of codes and ranges, e.g.
+# "0x20-0x7e,0xa1-0xbf", or as @file with such lists on every line. Glyph
+# codes in the output are the UTF-8 bytes of the codepoint as one number, the
+# same as tChar codes and what utf8_next_char() returns.
+#
+# The atlas has 1 bit per pixel, set for uncolored pixels like tImage. The
+# rows of a glyph follow each other without padding, starting at its offset,
+# which is a bit offset in the atlas.
+#
+# Advances and kerning are fixed point, in 1/16 pixels. Outline fonts have
+# fractional advances and the pairs of their kern table, bitmap fonts whole
+# pixel advances and no kerning. A kerning file adds or replaces pairs, it
+# has a line for every pair: the left and the right character, as the
+# character itself or as a code like 0x2c, and the adjustment in pixels,
+# e.g. "T o -1.5". The pairs of a glyph are stored after those of the glyph
+# before it, sorted by the right glyph.
+#
+# The hash of a font is FNV-1a over its height, baseline, glyph metrics,
+# kerning and atlas, so caches of rendered text can tell fonts apart.
+#
+# The tPackedFont is called <name>_packed, where name defaults to the name of
+# the tFont in an LCD Image Converter header, or the file name otherwise. A
+# tFont called <name> that points to it is generated as well, so the header
+# takes the place of the one it was compiled from.
+#
+# usage: font_compiler.py -c 0x20-0x7e [-k ubuntu12.kern] -o ubuntu12_packed.h ubuntu12.h
+#
+
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+# font_ranges is imported from the source tree, keep it clean of .pyc files
+sys.dont_write_bytecode = True
+from font_ranges import find_ranges  # noqa: E402
+
+try:
+    unichr
+except NameError:
+    unichr = chr
+
+# Keep in sync with GLYPH_ADVANCE_SHIFT in image.h
+ADVANCE_ONE = 16
+
+
+class Glyph(object):
+    """ Bitmap of a glyph, rows of 0/1 ink values, positioned from the pen
+        position on the baseline: left is the bearing, top is the height of
+        the top row above the baseline. advance is in 1/16 pixels. """
+
+    def __init__(self, advance, left, top, rows):
+        self.advance = advance
+        self.left = left
+        self.top = top
+        self.rows = rows
+
+    def trim(self):
+        """ Cut the bitmap to the bounding box of its ink """
+        inked = [y for y, row in enumerate(self.rows) if any(row)]
+        if not inked:
+            return Glyph(self.advance, 0, 0, [])
+        columns = [x for x in range(len(self.rows[0])) if any(row[x] for row in self.rows)]
+        first, last = inked[0], inked[-1]
+        left, right = columns[0], columns[-1]
+        rows = [row[left:right + 1] for row in self.rows[first:last + 1]]
+        return Glyph(self.advance, self.left + left, self.top - first, rows)
+
+
+class Font(object):
+    def __init__(self, ascent, descent, glyphs, name=None, kerning=None):
+        self.ascent = ascent
+        self.descent = descent
+        # codepoint -> Glyph
+        self.glyphs = glyphs
+        self.name = name
+        # (left, right) codepoints -> adjustment in 1/16 pixels
+        self.kerning = kerning or (lambda left, right: 0)
+
+
+def bits(value, count):
+    """ count bits of value, most significant first """
+    return [(value >> (count - 1 - i)) & 1 for i in range(count)]
+
+
+def read_bdf(path, args):
+    glyphs = {}
+    ascent = descent = None
+    with open(path) as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == "FONT_ASCENT":
+            ascent = int(words[1])
+        elif words[0] == "FONT_DESCENT":
+            descent = int(words[1])
+        elif words[0] == "STARTCHAR":
+            code = advance = box = None
+            rows = []
+            for line in lines:
+                words = line.split()
+                if words[0] == "ENCODING":
+                    code = int(words[1])
+                elif words[0] == "DWIDTH":
+                    advance = int(words[1])
+                elif words[0] == "BBX":
+                    box = [int(w) for w in words[1:5]]
+                elif words[0] == "BITMAP":
+                    for line in lines:
+                        if line.strip() == "ENDCHAR":
+                            break
+                        data = line.strip()
+                        rows.append(bits(int(data, 16), len(data) * 4)[:box[0]])
+                    break
+            if code is not None and code >= 0 and box is not None:
+                width, height, x, y = box
+                glyphs[code] = Glyph(advance * ADVANCE_ONE, x, y + height, rows)
+    if ascent is None or descent is None:
+        raise ValueError("%s: no FONT_ASCENT or FONT_DESCENT" % path)
+    return Font(ascent, descent, glyphs)
+
+
+PCF_ACCELERATORS = 1 << 1
+PCF_METRICS = 1 << 2
+PCF_BITMAPS = 1 << 3
+PCF_BDF_ENCODINGS = 1 << 5
+PCF_BDF_ACCELERATORS = 1 << 8
+
+PCF_COMPRESSED_METRICS = 0x100
+
+
+class PcfTable(object):
+    def __init__(self, data, offset):
+        self.data = data
+        self.format = struct.unpack_from("<i", data, offset)[0]
+        self.order = ">" if self.format & (1 << 2) else "<"
+        self.pos = offset + 4
+
+    def read(self, fmt):
+        values = struct.unpack_from(self.order + fmt, self.data, self.pos)
+        self.pos += struct.calcsize(self.order + fmt)
+        return values if len(values) > 1 else values[0]
+
+
+def read_pcf(path, args):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x01fcp":
+        raise ValueError("%s: not a PCF font (compressed fonts must be uncompressed first)" % path)
+    tables = {}
+    count = struct.unpack_from("<i", data, 4)[0]
+    for i in range(count):
+        kind, fmt, size, offset = struct.unpack_from("<iiii", data, 8 + 16 * i)
+        tables[kind] = offset
+
+    table = PcfTable(data, tables[PCF_BDF_ACCELERATORS if PCF_BDF_ACCELERATORS in tables else PCF_ACCELERATORS])
+    table.read("8B")
+    ascent, descent = table.read("ii")
+
+    table = PcfTable(data, tables[PCF_METRICS])
+    metrics = []
+    if table.format & PCF_COMPRESSED_METRICS:
+        for i in range(table.read("h")):
+            metrics.append([v - 0x80 for v in table.read("5B")])
+    else:
+        for i in range(table.read("i")):
+            metrics.append(list(table.read("5hH")[:5]))
+
+    table = PcfTable(data, tables[PCF_BITMAPS])
+    glyph_count = table.read("i")
+    offsets = [table.read("i") for i in range(glyph_count)]
+    table.read("4i")
+    start = table.pos
+    pad = 1 << (table.format & 3)
+    unit = 1 << ((table.format >> 4) & 3)
+    msb_bit = table.format & (1 << 3)
+    swap = table.order == "<" and unit > 1
+
+    def bitmap(index):
+        left, right, advance, up, down = metrics[index]
+        width, height = right - left, up + down
+        stride = ((width + 7) // 8 + pad - 1) // pad * pad
+        raw = bytearray(data[start + offsets[index]:start + offsets[index] + stride * height])
+        if swap:
+            for i in range(0, len(raw), unit):
+                raw[i:i + unit] = raw[i:i + unit][::-1]
+        if not msb_bit:
+            raw = bytearray(int("{:08b}".format(b)[::-1], 2) for b in raw)
+        rows = []
+        for y in range(height):
+            row = []
+            for b in raw[y * stride:(y + 1) * stride]:
+                row.extend(bits(b, 8))
+            rows.append(row[:width])
+        return Glyph(advance * ADVANCE_ONE, left, up, rows)
+
+    table = PcfTable(data, tables[PCF_BDF_ENCODINGS])
+    min2, max2, min1, max1, default = table.read("5h")
+    glyphs = {}
+    for byte1 in range(min1, max1 + 1):
+        for byte2 in range(min2, max2 + 1):
+            index = table.read("H")
+            if index != 0xFFFF:
+                glyphs[(byte1 << 8) | byte2] = bitmap(index)
+    return Font(ascent, descent, glyphs)
+
+
+def read_outline(path, args):
+    try:
+        import freetype
+    except ImportError:
+        raise ValueError("%s: outline fonts need freetype-py (pip install freetype-py)" % path)
+    if args.size is None:
+        raise ValueError("%s: outline fonts need --size" % path)
+    face = freetype.Face(path)
+    face.set_pixel_sizes(0, args.size)
+    glyphs = {}
+    for code, index in face.get_chars():
+        face.load_char(code, freetype.FT_LOAD_RENDER | freetype.FT_LOAD_TARGET_MONO)
+        glyph = face.glyph
+        bitmap = glyph.bitmap
+        rows = []
+        for y in range(bitmap.rows):
+            row = []
+            for b in bitmap.buffer[y * bitmap.pitch:(y + 1) * bitmap.pitch]:
+                row.extend(bits(b, 8))
+            rows.append(row[:bitmap.width])
+        # the unhinted advance, 16.16 fixed point
+        glyphs[code] = Glyph((glyph.linearHoriAdvance + 0x800) >> 12, glyph.bitmap_left, glyph.bitmap_top, rows)
+
+    def kerning(left, right):
+        # 26.6 fixed point
+        return (face.get_kerning(left, right, freetype.FT_KERNING_UNFITTED).x + 2) >> 2
+
+    return Font(face.size.ascender >> 6, -face.size.descender >> 6, glyphs,
+        kerning=kerning if face.has_kerning else None)
+
+
+LCD_IMAGE_RE = re.compile(r"tImage\s+(\w+)\s*=\s*\{\s*(\w+)\s*,\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)")
+LCD_DATA_RE = re.compile(r"uint8_t\s+(\w+)\s*\[\s*\d+\s*\]\s*=\s*\{([^}]*)\}")
+LCD_CHAR_RE = re.compile(r"\{\s*(0x[0-9a-fA-F]+)\s*,\s*&(\w+)\s*\}")
+LCD_FONT_RE = re.compile(r"const\s+tFont\s+(\w+)\s*=")
+LCD_ARRAY_RE = re.compile(r"const\s+tChar\s+\w+\s*\[")
+LCD_IF_RE = re.compile(r"#if\s*\(\s*(0x[0-9a-fA-F]+)\s*==\s*(0x[0-9a-fA-F]+)\s*\)")
+
+
+def utf8_code_to_codepoint(code):
+    """ tChar code, the UTF-8 bytes as one number, to a Unicode codepoint """
+    data = bytearray()
+    while code:
+        data.insert(0, code & 0xFF)
+        code >>= 8
+    return ord(bytes(data).decode("utf-8")) if data else 0
+
+
+def codepoint_to_utf8_code(codepoint):
+    code = 0
+    for b in bytearray(unichr(codepoint).encode("utf-8")):
+        code = (code << 8) | b
+    return code
+
+
+def read_lcd(path, args):
+    with open(path) as f:
+        text = f.read()
+    images = {}
+    data = {}
+    for match in LCD_IMAGE_RE.finditer(text):
+        images[match.group(1)] = (match.group(2), int(match.group(3)), int(match.group(4)), int(match.group(5)))
+    for match in LCD_DATA_RE.finditer(text):
+        data[match.group(1)] = [int(b, 16) for b in re.findall(r"0x[0-9a-fA-F]+", match.group(2))]
+
+    cells = {}
+    active = [True]
+    match = LCD_ARRAY_RE.search(text)
+    if match is None:
+        raise ValueError("%s: no tChar array" % path)
+    for line in text[match.end():].splitlines():
+        line = line.strip()
+        match = LCD_IF_RE.match(line)
+        if match:
+            active.append(int(match.group(1), 16) == int(match.group(2), 16))
+        elif line.startswith("#else"):
+            active[-1] = not active[-1]
+        elif line.startswith("#endif"):
+            active.pop()
+        elif all(active):
+            match = LCD_CHAR_RE.search(line)
+            if match:
+                name, width, height, size = images[match.group(2)]
+                if size != 8:
+                    raise ValueError("%s: only 8 bit data blocks are supported" % path)
+                stride = (width + 7) // 8
+                rows = []
+                for y in range(height):
+                    row = []
+                    for b in data[name][y * stride:(y + 1) * stride]:
+                        # set bits are uncolored
+                        row.extend(1 - v for v in bits(b, 8))
+                    rows.append(row[:width])
+                cells[utf8_code_to_codepoint(int(match.group(1), 16))] = rows
+
+    height = max(len(rows) for rows in cells.values())
+    baseline = args.baseline
+    if baseline is None:
+        # the bottom of the glyphs that sit on the baseline
+        baseline = 0
+        for code in list(range(ord("0"), ord("9") + 1)) + list(range(ord("A"), ord("Z") + 1)):
+            if code in cells and code != ord("Q"):
+                inked = [y for y, row in enumerate(cells[code]) if any(row)]
+                if inked:
+                    baseline = max(baseline, inked[-1] + 1)
+        if baseline == 0:
+            raise ValueError("%s: cannot find the baseline, use --baseline" % path)
+    glyphs = {}
+    for code, rows in cells.items():
+        glyphs[code] = Glyph((len(rows[0]) if rows else 0) * ADVANCE_ONE, 0, baseline, rows)
+    match = LCD_FONT_RE.search(text)
+    return Font(baseline, height - baseline, glyphs, match.group(1) if match else None)
+
+
+READERS = {
+    ".bdf": read_bdf,
+    ".pcf": read_pcf,
+    ".ttf": read_outline,
+    ".otf": read_outline,
+    ".h": read_lcd,
+}
+
+
+def parse_character(text):
+    """ codepoint of a character of a kerning file """
+    if len(text) > 2 and text[:2].lower() in ("0x", "u+"):
+        return int(text[2:], 16)
+    if not isinstance(text, type(u"")):
+        text = text.decode("utf-8")
+    if len(text) != 1:
+        raise ValueError("%s is not a character" % text)
+    return ord(text)
+
+
+def read_kerning(path, font):
+    """ Add the pairs of a kerning file to font, raises ValueError """
+    pairs = {}
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split("#")[0].split()
+            if not fields:
+                continue
+            try:
+                if len(fields) != 3:
+                    raise ValueError("expected left, right and pixels")
+                pair = (parse_character(fields[0]), parse_character(fields[1]))
+                pairs[pair] = int(round(float(fields[2]) * ADVANCE_ONE))
+            except ValueError as e:
+                raise ValueError("%s:%d: %s" % (path, number, e))
+    kerning = font.kerning
+    font.kerning = lambda left, right: pairs[(left, right)] if (left, right) in pairs else kerning(left, right)
+
+
+def parse_codepoints(spec):
+    if spec.startswith("@"):
+        with open(spec[1:]) as f:
+            spec = ",".join(line.split("#")[0] for line in f)
+    codepoints = set()
+    for part in spec.replace("\n", ",").split(","):
+        part = part.strip()
+        if not part:
+            continue
+        if "-" in part:
+            first, last = part.split("-")
+            codepoints.update(range(int(first, 0), int(last, 0) + 1))
+        else:
+            codepoints.add(int(part, 0))
+    return codepoints
+
+
+def pack(font, codepoints):
+    """ Glyph entries (utf8 code, codepoint, bit offset, glyph) and atlas bits """
+    entries = []
+    atlas = []
+    for codepoint in sorted(codepoints):
+        glyph = font.glyphs[codepoint].trim()
+        entries.append((codepoint_to_utf8_code(codepoint), codepoint, len(atlas), glyph))
+        for row in glyph.rows:
+            # set bits are uncolored
+            atlas.extend(1 - v for v in row)
+    while len(atlas) % 8:
+        atlas.append(1)
+    data = [int("".join(str(b) for b in atlas[i:i + 8]), 2) for i in range(0, len(atlas), 8)]
+    return entries, data
+
+
+def check_range(name, value, low, high):
+    if not low <= value <= high:
+        raise ValueError("%s %d does not fit in [%d, %d]" % (name, value, low, high))
+    return value
+
+
+def load_font(path, args):
+    """ Font of a file in one of the formats of READERS, raises ValueError """
+    extension = os.path.splitext(path)[1].lower()
+    if extension not in READERS:
+        raise ValueError("%s: unsupported font format" % path)
+    return READERS[extension](path, args)
+
+
+def glyph_metrics(font, entries):
+    """ (code, offset, width, height, left, top, advance, kerning) of every
+        packed glyph, the fields of a tGlyph, and the (right, adjust) kerning
+        pairs, the fields of a tKernPair. raises ValueError when a glyph does
+        not fit them. """
+    metrics = []
+    pairs = []
+    for code, codepoint, offset, glyph in entries:
+        width = len(glyph.rows[0]) if glyph.rows else 0
+        first = len(pairs)
+        for right, entry in enumerate(entries):
+            adjust = font.kerning(codepoint, entry[1])
+            if adjust != 0:
+                pairs.append((right, adjust))
+        try:
+            for right, adjust in pairs[first:]:
+                check_range("kerning", adjust, -32768, 32767)
+            metrics.append((code, offset,
+                check_range("width", width, 0, 255),
+                check_range("height", len(glyph.rows), 0, 255),
+                check_range("left", glyph.left, -128, 127),
+                check_range("top", font.ascent - glyph.top if glyph.rows else 0, -128, 127),
+                check_range("advance", glyph.advance, 0, 65535),
+                check_range("kerning pairs", first, 0, 65535)))
+        except ValueError as e:
+            raise ValueError("U+%04X: %s" % (codepoint, e))
+    if len(pairs) > 65535:
+        raise ValueError("%d kerning pairs, at most 65535" % len(pairs))
+    return metrics, pairs
+
+
+def font_hash(height, baseline, metrics, pairs, atlas):
+    """ hash of a tPackedFont, never 0 """
+    data = bytearray([height, baseline])
+    for metric in metrics:
+        data += struct.pack("<iIBBbbHH", *metric)
+    for pair in pairs:
+        data += struct.pack("<Hh", *pair)
+    data += bytearray(atlas)
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h or 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a font to a tPackedFont atlas")
+    parser.add_argument("-o", "--output", required=True, help="generated header")
+    parser.add_argument("-n", "--name", help="name of the font")
+    parser.add_argument("-c", "--codepoints", help="codepoints to include, all when omitted")
+    parser.add_argument("-s", "--size", type=int, help="pixel size of outline fonts")
+    parser.add_argument("-b", "--baseline", type=int, help="baseline of LCD Image Converter fonts")
+    parser.add_argument("-k", "--kerning", help="kerning pairs to add to those of the font")
+    parser.add_argument("font", help="BDF, PCF, TTF/OTF or LCD Image Converter header")
+    args = parser.parse_args()
+
+    try:
+        font = load_font(args.font, args)
+        if args.kerning:
+            read_kerning(args.kerning, font)
+    except (IOError, ValueError) as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    codepoints = parse_codepoints(args.codepoints) if args.codepoints else set(font.glyphs)
+    missing = sorted(c for c in codepoints if c not in font.glyphs)
+    if missing:
+        print("%s: no glyphs for %s" % (args.font, ", ".join("U+%04X" % c for c in missing)), file=sys.stderr)
+        codepoints -= set(missing)
+
+    entries, atlas = pack(font, codepoints)
+    try:
+        metrics, pairs = glyph_metrics(font, entries)
+    except ValueError as e:
+        print("%s: %s" % (args.font, e), file=sys.stderr)
+        return 1
+    name = args.name or font.name or re.sub(r"\W", "_", os.path.splitext(os.path.basename(args.font))[0])
+    height = font.ascent + font.descent
+
+    out = []
+    out.append("/* Generated from %s by tools/font_compiler.py, do not edit */" % os.path.basename(args.font))
+    out.append("")
+    out.append('#include "image.h"')
+    out.append("#include <stddef.h>")
+    out.append("")
+    out.append("static const uint8_t %s_atlas[%d] = {" % (name, max(len(atlas), 1)))
+    for i in range(0, len(atlas), 20):
+        out.append("    " + ", ".join("0x%02x" % b for b in atlas[i:i + 20]) + ",")
+    if not atlas:
+        out.append("    0xff,")
+    out.append("};")
+    out.append("")
+    out.append("static const tGlyph %s_glyphs[%d] = {" % (name, len(entries)))
+    for metric, entry in zip(metrics, entries):
+        codepoint = entry[1]
+        out.append("    { 0x%x, %d, %d, %d, %d, %d, %d, %d }, // U+%04X%s" % (metric + (
+            codepoint, " '%s'" % chr(codepoint) if 0x20 < codepoint < 0x7f else "")))
+    out.append("};")
+    out.append("")
+    if pairs:
+        out.append("static const tKernPair %s_kerning[%d] = {" % (name, len(pairs)))
+        for i in range(0, len(pairs), 8):
+            out.append("    " + " ".join("{ %d, %d }," % pair for pair in pairs[i:i + 8]))
+        out.append("};")
+        out.append("")
+    ranges = find_ranges([entry[0] for entry in entries])
+    table = ", ".join("{ 0x%x, %d, %d }" % r for r in ranges)
+    out.append("const tPackedFont %s_packed = { %d, %s_glyphs, %s_atlas, %d, %d, %d, %s, 0x%08x, %d, %s };" % (
+        name, len(entries), name, name, height, font.ascent, len(ranges),
+        "(const tFontRange[]) { %s }" % table if ranges else "NULL",
+        font_hash(height, font.ascent, metrics, pairs, atlas),
+        len(pairs), "%s_kerning" % name if pairs else "NULL"))
+    out.append("const tFont %s = { 0, NULL, 0, NULL, &%s_packed };" % (name, name))
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+    print("%s: %d glyphs, %d byte atlas, %d kerning pairs, height %d, baseline %d" % (
+        args.output, len(entries), len(atlas), len(pairs), height, font.ascent))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+#
+# Generates the direct index tables of the fonts converted by LCD Image
+# Converter. Every run of consecutive character codes in a font's tChar array
+# becomes a tFontRange, so find_char_by_code() finds those characters with a
+# single indexed load. Codes outside the ranges are still found by the binary
+# search over the whole array.
+#
+# usage: font_ranges.py -o font_ranges.h ubuntu10.h ubuntu12.h ...
+#
+
+from __future__ import print_function
+
+import argparse
+import re
+import sys
+
+# Runs shorter than this are left to the binary search
+MIN_RANGE_LENGTH = 4
+
+FONT_RE = re.compile(r"const\s+tFont\s+(\w+)\s*=\s*\{\s*(\d+)\s*,\s*(\w+)\s*[,}]")
+ARRAY_RE = re.compile(r"const\s+tChar\s+(\w+)\s*\[\s*\]\s*=")
+IF_RE = re.compile(r"#if\s*\(\s*(0x[0-9a-fA-F]+)\s*==\s*(0x[0-9a-fA-F]+)\s*\)")
+CHAR_RE = re.compile(r"\{\s*(0x[0-9a-fA-F]+)\s*,\s*&\w+\s*\}")
+
+
+def read_codes(text, array):
+    """ Character codes of the tChar array, in the order they are stored """
+    start = None
+    for match in ARRAY_RE.finditer(text):
+        if match.group(1) == array:
+            start = match.end()
+    if start is None:
+        raise ValueError("tChar array %s not found" % array)
+
+    codes = []
+    # LCD Image Converter puts each entry in an #if/#else, only one is compiled
+    active = [True]
+    for line in text[start:text.index("};", start)].splitlines():
+        line = line.strip()
+        match = IF_RE.match(line)
+        if match:
+            active.append(int(match.group(1), 16) == int(match.group(2), 16))
+        elif line.startswith("#if"):
+            raise ValueError("unsupported condition in %s: %s" % (array, line))
+        elif line.startswith("#else"):
+            active[-1] = not active[-1]
+        elif line.startswith("#endif"):
+            active.pop()
+        elif all(active):
+            match = CHAR_RE.search(line)
+            if match:
+                codes.append(int(match.group(1), 16))
+    return codes
+
+
+def find_ranges(codes):
+    """ (first code, count, index) of every run of consecutive codes """
+    ranges = []
+    index = 0
+    while index < len(codes):
+        end = index + 1
+        while end < len(codes) and codes[end] == codes[end - 1] + 1:
+            end += 1
+        if end - index >= MIN_RANGE_LENGTH:
+            ranges.append((codes[index], end - index, index))
+        index = end
+    return ranges
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate direct index tables for tFont")
+    parser.add_argument("-o", "--output", required=True, help="generated header")
+    parser.add_argument("fonts", nargs="+", help="font headers from LCD Image Converter")
+    args = parser.parse_args()
+
+    out = []
+    out.append("/* Generated by tools/font_ranges.py, do not edit */")
+    out.append("")
+    out.append("#ifndef FONT_RANGES_H")
+    out.append("#define FONT_RANGES_H")
+    out.append("")
+    out.append('#include "image.h"')
+    out.append("#include <stddef.h>")
+
+    for path in args.fonts:
+        with open(path) as f:
+            text = f.read()
+        match = FONT_RE.search(text)
+        if match is None:
+            print("%s: no tFont found" % path, file=sys.stderr)
+            return 1
+        name, length, array = match.group(1), int(match.group(2)), match.group(3)
+        codes = read_codes(text, array)
+        if len(codes) != length:
+            print("%s: %s has %d characters, not %d" % (path, array, len(codes), length), file=sys.stderr)
+            return 1
+        if codes != sorted(codes):
+            print("%s: %s is not sorted by code" % (path, array), file=sys.stderr)
+            return 1
+
+        ranges = find_ranges(codes)
+        out.append("")
+        out.append("// %s, %d of %d characters directly indexed" % (name, sum(r[1] for r in ranges), length))
+        # count and table of the tFont, as a compound literal so that fonts a
+        # file does not include cost nothing
+        table = ", ".join("{ 0x%x, %d, %d }" % r for r in ranges)
+        out.append("#define %s_RANGES %d, %s" % (name, len(ranges), "(const tFontRange[]) { %s }" % table if ranges else "NULL"))
+
+    out.append("")
+    out.append("#endif /* FONT_RANGES_H */")
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
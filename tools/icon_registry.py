@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+#
+# Generates the weather icon registry: the WeatherIcon enum, the assets of
+# every icon and, for every weather provider, a perfect hash from the icon
+# strings of the provider to the enum.
+#
+# The icons file has a line for every icon: its name, the asset drawn for
+# the current weather and the asset drawn for a forecast day. A provider file
+# has a line for every icon string of the provider: the string and the name
+# of the icon. Everything after a # is a comment.
+#
+# The hash of a string is (length + a * s[i] + s[j]) & mask, where i counts
+# from the start and j from the end of the string. The generator searches
+# the a, i, j and smallest power of two table that give every string of the
+# provider its own slot, so a lookup is one hash and one strcmp.
+#
+# usage: icon_registry.py -o weather_icons.h weather_icons.txt darksky=darksky_icons.txt
+#
+
+from __future__ import print_function
+
+import argparse
+import re
+import sys
+
+NAME_RE = re.compile(r"^[A-Z][A-Z0-9_]*$")
+PROVIDER_RE = re.compile(r"^[a-z][a-z0-9_]*$")
+
+
+def read_table(path, columns):
+    rows = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split("#")[0].split()
+            if not fields:
+                continue
+            if len(fields) != columns:
+                raise ValueError("%s:%d: expected %d columns" % (path, number, columns))
+            rows.append(fields)
+    return rows
+
+
+def find_hash(strings):
+    """ (multiplier, index from start, index from end, table size) of a
+        perfect hash for strings """
+    shortest = min(len(s) for s in strings)
+    size = 1
+    while size < len(strings):
+        size *= 2
+    while True:
+        for multiplier in range(1, 32):
+            for first in range(min(shortest, 8)):
+                for last in range(1, min(shortest, 8) + 1):
+                    slots = set((len(s) + multiplier * ord(s[first]) + ord(s[-last])) & (size - 1) for s in strings)
+                    if len(slots) == len(strings):
+                        return multiplier, first, last, size
+        size *= 2
+
+
+def c_string(s):
+    return '"%s"' % s.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the weather icon registry")
+    parser.add_argument("-o", "--output", required=True, help="generated header")
+    parser.add_argument("icons", help="icons and their assets")
+    parser.add_argument("providers", nargs="*", help="name=file with the icon strings of a provider")
+    args = parser.parse_args()
+
+    try:
+        icons = read_table(args.icons, 3)
+        providers = []
+        for spec in args.providers:
+            name, _, path = spec.partition("=")
+            if not PROVIDER_RE.match(name) or not path:
+                raise ValueError("%s: expected provider=file" % spec)
+            providers.append((name, path, read_table(path, 2)))
+    except (IOError, ValueError) as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    names = [icon[0] for icon in icons]
+    for name in names:
+        if not NAME_RE.match(name) or name in ("NONE", "COUNT") or names.count(name) > 1:
+            print("%s: invalid or duplicate icon name %s" % (args.icons, name), file=sys.stderr)
+            return 1
+
+    out = []
+    out.append("/* Generated by tools/icon_registry.py, do not edit */")
+    out.append("")
+    out.append("#ifndef WEATHER_ICONS_H")
+    out.append("#define WEATHER_ICONS_H")
+    out.append("")
+    out.append("#include <string.h>")
+    out.append("")
+    out.append("typedef enum {")
+    out.append("    WEATHER_ICON_NONE,")
+    for name in names:
+        out.append("    WEATHER_ICON_%s," % name)
+    out.append("    WEATHER_ICON_COUNT")
+    out.append("} WeatherIcon;")
+    out.append("")
+    out.append("// Names of the assets of an icon, for the current weather and a forecast day")
+    out.append("typedef struct {")
+    out.append("    const char* large;")
+    out.append("    const char* small;")
+    out.append("} WeatherIconAssets;")
+    out.append("")
+    out.append("/**")
+    out.append(" *  @brief: the assets of an icon, NULL names for WEATHER_ICON_NONE")
+    out.append(" */")
+    out.append("static inline const WeatherIconAssets* weather_icon_assets(WeatherIcon icon)")
+    out.append("{")
+    out.append("    static const WeatherIconAssets assets[WEATHER_ICON_COUNT] = {")
+    out.append("        { NULL, NULL },")
+    for name, large, small in icons:
+        out.append("        { %s, %s }, // WEATHER_ICON_%s" % (c_string(large), c_string(small), name))
+    out.append("    };")
+    out.append("")
+    out.append("    return &assets[(unsigned)icon < WEATHER_ICON_COUNT ? icon : WEATHER_ICON_NONE];")
+    out.append("}")
+
+    for provider, path, rows in providers:
+        strings = [row[0] for row in rows]
+        for string, name in rows:
+            if name not in names:
+                print("%s: %s is not an icon of %s" % (path, name, args.icons), file=sys.stderr)
+                return 1
+            if strings.count(string) > 1:
+                print("%s: %s is listed more than once" % (path, string), file=sys.stderr)
+                return 1
+        if not rows:
+            print("%s: no icon strings" % path, file=sys.stderr)
+            return 1
+
+        multiplier, first, last, size = find_hash(strings)
+        slots = [None] * size
+        for string, name in rows:
+            slots[(len(string) + multiplier * ord(string[first]) + ord(string[-last])) & (size - 1)] = (string, name)
+
+        shortest = min(len(s) for s in strings)
+        out.append("")
+        out.append("/**")
+        out.append(" *  @brief: the icon of an icon string of %s, WEATHER_ICON_NONE for" % provider)
+        out.append(" *          strings it does not have")
+        out.append(" */")
+        out.append("static inline WeatherIcon %s_icon(const char* string)" % provider)
+        out.append("{")
+        out.append("    // icon strings by their hash")
+        out.append("    static const struct {")
+        out.append("        const char* string;")
+        out.append("        WeatherIcon icon;")
+        out.append("    } slots[%d] = {" % size)
+        for slot in slots:
+            if slot is None:
+                out.append('        { "", WEATHER_ICON_NONE },')
+            else:
+                out.append("        { %s, WEATHER_ICON_%s }," % (c_string(slot[0]), slot[1]))
+        out.append("    };")
+        out.append("    size_t length = strlen(string);")
+        out.append("")
+        out.append("    if (length < %d) {" % shortest)
+        out.append("        return WEATHER_ICON_NONE;")
+        out.append("    }")
+        out.append("    size_t slot = (length + %d * (unsigned char)string[%d] + (unsigned char)string[length - %d]) & %d;" % (
+            multiplier, first, last, size - 1))
+        out.append("")
+        out.append("    return strcmp(slots[slot].string, string) == 0 ? slots[slot].icon : WEATHER_ICON_NONE;")
+        out.append("}")
+
+    out.append("")
+    out.append("#endif /* WEATHER_ICONS_H */")
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
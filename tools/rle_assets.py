@@ -0,0 +1,142 @@
+#!/usr/bin/env python
+#
+# Compresses the monochrome bitmaps of a header made by LCD Image Converter
+# (fonts and icons) to IMAGE_RLE. The output is the same header with every
+# image_data_* array replaced by its run lengths and every tImage marked as
+# IMAGE_RLE. Bitmaps that do not get smaller are left as they are.
+#
+# The pixels of a bitmap are read row by row, without the padding bits at the
+# end of each row, as runs that alternate between set (uncolored) and clear
+# (colored) bits, starting with set bits. Every run is a 4 bit code, two codes
+# to a byte, high nibble first:
+#
+#   1 - 15   a run of that many pixels
+#   0        followed by the run length in 3 bit groups, least significant
+#            group first, bit 3 set on every group but the last. Used for
+#            runs of 0 or more than 15 pixels.
+#
+# usage: rle_assets.py -o icons_rle.h icons.h
+#
+
+from __future__ import print_function
+
+import argparse
+import re
+import sys
+
+IMAGE_RE = re.compile(r"(const\s+tImage\s+\w+\s*=\s*\{\s*(\w+)\s*,\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+))(\s*\})")
+DATA_RE = re.compile(r"(static\s+const\s+uint8_t\s+(\w+)\s*)\[\s*\d+\s*\](\s*=\s*\{)([^}]*)(\})")
+
+
+def read_pixels(data, width, height):
+    """ Pixel bits of a bitmap stored in rows of whole bytes """
+    stride = (width + 7) // 8
+    pixels = []
+    for y in range(height):
+        for x in range(width):
+            pixels.append((data[y * stride + x // 8] >> (7 - x % 8)) & 1)
+    return pixels
+
+
+def find_runs(pixels):
+    runs = []
+    value = 1
+    run = 0
+    for pixel in pixels:
+        if pixel == value:
+            run += 1
+        else:
+            runs.append(run)
+            value = pixel
+            run = 1
+    runs.append(run)
+    return runs
+
+
+def encode_runs(runs):
+    codes = []
+    for run in runs:
+        if 0 < run <= 15:
+            codes.append(run)
+            continue
+        codes.append(0)
+        while True:
+            group = run & 0x07
+            run >>= 3
+            if run:
+                codes.append(group | 0x08)
+            else:
+                codes.append(group)
+                break
+    if len(codes) % 2:
+        codes.append(0)
+    return [(codes[i] << 4) | codes[i + 1] for i in range(0, len(codes), 2)]
+
+
+def compress_bitmap(data, width, height):
+    """ IMAGE_RLE data of a bitmap stored in rows of whole bytes, None when
+        it does not get smaller """
+    if len(data) != (width + 7) // 8 * height:
+        raise ValueError("%d bytes for %dx%d pixels" % (len(data), width, height))
+    rle = encode_runs(find_runs(read_pixels(data, width, height)))
+    return rle if len(rle) < len(data) else None
+
+
+def format_array(data):
+    lines = []
+    for i in range(0, len(data), 20):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 20]))
+    return "\n" + ",\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compress LCD Image Converter bitmaps to IMAGE_RLE")
+    parser.add_argument("-o", "--output", required=True, help="compressed header")
+    parser.add_argument("input", help="header from LCD Image Converter")
+    args = parser.parse_args()
+
+    with open(args.input) as f:
+        text = f.read()
+
+    sizes = {}
+    for match in IMAGE_RE.finditer(text):
+        sizes[match.group(2)] = (int(match.group(3)), int(match.group(4)), int(match.group(5)))
+
+    compressed = set()
+    raw_total = [0, 0]
+
+    def compress(match):
+        name = match.group(2)
+        data = [int(b, 16) for b in re.findall(r"0x[0-9a-fA-F]+", match.group(4))]
+        raw_total[0] += len(data)
+        if name not in sizes or sizes[name][2] != 8:
+            raw_total[1] += len(data)
+            return match.group(0)
+        try:
+            rle = compress_bitmap(data, sizes[name][0], sizes[name][1])
+        except ValueError as e:
+            raise ValueError("%s: %s" % (name, e))
+        if rle is None:
+            raw_total[1] += len(data)
+            return match.group(0)
+        compressed.add(name)
+        raw_total[1] += len(rle)
+        return "%s[%d]%s%s%s" % (match.group(1), len(rle), match.group(3), format_array(rle), match.group(5))
+
+    def mark(match):
+        if match.group(2) not in compressed:
+            return match.group(0)
+        return "%s, IMAGE_RLE%s" % (match.group(1), match.group(6))
+
+    text = DATA_RE.sub(compress, text)
+    text = IMAGE_RE.sub(mark, text)
+    text = "/* Generated from %s by tools/rle_assets.py, do not edit */\n\n" % args.input.replace("\\", "/").split("/")[-1] + text
+
+    with open(args.output, "w") as f:
+        f.write(text)
+    print("%s: %d of %d bitmaps compressed, %d -> %d bytes" % (args.output, len(compressed), len(sizes), raw_total[0], raw_total[1]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())